@@ -1,47 +1,52 @@
 #pragma once
 
 #include "Collider.h"
+#include "AABBRenderer.h"
 
-class AABBCollider : public Collider {
+template <typename P>
+class AABBColliderT : public ColliderT<P> {
 private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+
 	vec3 position;
 	float width, height;
 	bool isGameWonTrigger;
 	bool isGameWon;
 
 public:
-	AABBCollider(vec3 position, float width, float height, GLhandleARB shaderProgramId) : Collider() {
+	AABBColliderT(vec3 position, float width, float height, GLhandleARB shaderProgramId) : ColliderT<P>() {
 		this->position = position;
 		this->width = width;
 		this->height = height;
 		this->isGameWonTrigger = false;
 		this->isGameWon = false;
 
-		renderer = new AABBRenderer(shaderProgramId, position, width, height);
-		renderer->setupOpenGLBuffers();
+		this->renderer = new AABBRenderer(shaderProgramId, ::vec3(position), width, height);
+		this->renderer->setupOpenGLBuffers();
 	}
 
-	AABBCollider(vec3 position, float width, float height, GLhandleARB shaderProgramId, bool isTrigger) : AABBCollider(position, width, height, shaderProgramId) {
+	AABBColliderT(vec3 position, float width, float height, GLhandleARB shaderProgramId, bool isTrigger) : AABBColliderT(position, width, height, shaderProgramId) {
 		this->isGameWonTrigger = isTrigger;
 	}
 
 	void handleCollision(vec3 & particlePosition) {
-		float xDist, yDist;
+		scalar xDist, yDist;
 		//determine if particle is inside box
 		xDist = particlePosition.x - position.x;
 		yDist = particlePosition.y - position.y;
 
 		// if so, move it towards the position outside the box clostes to the current positions
-		if (abs(xDist) < width / 2 && abs(yDist) < height / 2) {
+		if (std::abs(xDist) < width / 2 && std::abs(yDist) < height / 2) {
 			//find distances to edges
-			float distToXEdge = width / 2.f - abs(xDist);
-			float distToYEdge = height / 2.f - abs(yDist);
+			scalar distToXEdge = width / 2.f - std::abs(xDist);
+			scalar distToYEdge = height / 2.f - std::abs(yDist);
 
 			//find pos on wall closest do currentparticle
 			if (distToXEdge < distToYEdge)
-				particlePosition.x = position.x + xDist / abs(xDist) * width*0.5f;
+				particlePosition.x = position.x + xDist / std::abs(xDist) * width*0.5f;
 			else
-				particlePosition.y = position.y + yDist / abs(yDist) * height*0.5f;
+				particlePosition.y = position.y + yDist / std::abs(yDist) * height*0.5f;
 			if (isGameWonTrigger && !isGameWon) {
 				std::cout << "!!! Game Won !!!\n";
 				isGameWon = true;
@@ -50,6 +55,19 @@ public:
 		}
 	}
 
+	//the box extends infinitely in z
+	scalar getDistance(const vec3 & particlePosition) {
+		scalar xDist = std::abs(particlePosition.x - position.x) - width / 2;
+		scalar yDist = std::abs(particlePosition.y - position.y) - height / 2;
+		if (xDist <= 0 && yDist <= 0)
+			return glm::max(xDist, yDist);
+		return glm::length(glm::vec<2, scalar>(glm::max(xDist, scalar(0)), glm::max(yDist, scalar(0))));
+	}
+
+	scalar getThickness() {
+		return scalar(glm::min(width, height));
+	}
+
 	vec3 getPosition() {
 		return position;
 	}
@@ -57,4 +75,11 @@ public:
 	void setPosition(vec3 position) {
 		this->position = position;
 	}
-};
\ No newline at end of file
+
+	void shiftOrigin(const vec3 & shift) {
+		position -= shift;
+		ColliderT<P>::shiftOrigin(shift);
+	}
+};
+
+typedef AABBColliderT<WorldPrecision> AABBCollider;
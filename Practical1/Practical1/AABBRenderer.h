@@ -49,4 +49,9 @@ public:
 		glDisableVertexAttribArray(vertexNormalAttribLocation);
 	}
 
+	void shiftOrigin(const vec3 & shift) {
+		for (vec3 & position : positions) {
+			position -= shift;
+		}
+	}
 };
\ No newline at end of file
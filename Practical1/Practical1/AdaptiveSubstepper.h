@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+
+// Chooses the number of substeps per frame from how far the fastest particle would move: one substep may move a
+// particle at most maxDisplacementFraction of the smallest feature (shortest constraint or thinnest collider).
+// Calm scenes take a single substep, fast swings are split up to the given cap. The solver keeps the velocity
+// across changed step sizes by rescaling the Verlet displacement.
+class AdaptiveSubstepper {
+private:
+	SCALAR maxDisplacementFraction;
+	int substeps = 1;
+
+public:
+	AdaptiveSubstepper(SCALAR maxDisplacementFraction) {
+		this->maxDisplacementFraction = maxDisplacementFraction;
+	}
+
+	int chooseSubsteps(SCALAR maxSpeed, SCALAR smallestFeatureSize, SCALAR frameTime, int maxSubsteps) {
+		SCALAR allowedDisplacement = maxDisplacementFraction * smallestFeatureSize;
+		SCALAR displacement = maxSpeed * frameTime;
+		if (allowedDisplacement <= 0 || displacement <= allowedDisplacement)
+			substeps = 1;
+		else
+			substeps = (int)std::ceil(displacement / allowedDisplacement);
+		substeps = glm::clamp(substeps, 1, glm::max(maxSubsteps, 1));
+		return substeps;
+	}
+
+	int getSubsteps() {
+		return substeps;
+	}
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+
+#include "Constraint.h"
+#include "ParticleStore.h"
+
+// Direct solver for distance constraints that form a chain (constraint j shares its second particle with the
+// first particle of constraint j + 1). The constraints are linearized and J W J^T lambda = -C is solved exactly,
+// which for a chain is a tridiagonal system and takes O(n) with the Thomas algorithm. One pass removes the
+// stretch of the whole chain up to second order, independent of its length.
+template <typename P>
+class ChainSolverT {
+private:
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	std::vector<accumulatorVec3> directions;
+	std::vector<accumulator> diagonal, offDiagonal, lambdas;
+
+	inline accumulator inverseMass(ParticleStoreT<P> & particles, int i) {
+		return particles.isMovables[i] ? accumulator(1) / particles.masses[i] : accumulator(0);
+	}
+
+public:
+	template <typename Index>
+	static bool isChain(std::vector<ConstraintT<P, Index> > & constraints) {
+		for (int j = 0; j + 1 < (int)constraints.size(); j++) {
+			if (constraints[j].getP2() != constraints[j + 1].getP1())
+				return false;
+		}
+		return true;
+	}
+
+	//Solves the chain and adds the violation of every constraint before the solve to the residual statistics
+	template <typename Index>
+	void solve(ParticleStoreT<P> & particles, int base, std::vector<ConstraintT<P, Index> > & constraints,
+		accumulator & maxResidual, accumulator & squaredResidualSum) {
+		std::vector<vec3> & positions = particles.positions;
+		int n = (int)constraints.size();
+		if (n == 0)
+			return;
+
+		directions.resize(n);
+		diagonal.resize(n);
+		offDiagonal.resize(n);
+		lambdas.resize(n);
+
+		//assemble the system: diagonal (w_a + w_b), off diagonal -w_shared * (d_j . d_j+1), right hand side -C
+		for (int j = 0; j < n; j++) {
+			int a = base + constraints[j].getP1();
+			int b = base + constraints[j].getP2();
+			accumulatorVec3 vec = accumulatorVec3(positions[b]) - accumulatorVec3(positions[a]);
+			accumulator length = glm::length(vec);
+			accumulator weight = inverseMass(particles, a) + inverseMass(particles, b);
+
+			if (length == accumulator(0) || weight == accumulator(0)) {
+				//degenerate or fully pinned constraint, keep its lambda at zero
+				directions[j] = accumulatorVec3(0, 0, 0);
+				diagonal[j] = 1;
+				lambdas[j] = 0;
+			}
+			else {
+				directions[j] = vec / length;
+				diagonal[j] = weight;
+				lambdas[j] = accumulator(constraints[j].getRestDistance()) - length;
+			}
+			maxResidual = glm::max(maxResidual, glm::abs(lambdas[j]));
+			squaredResidualSum += lambdas[j] * lambdas[j];
+		}
+		for (int j = 0; j < n - 1; j++) {
+			int shared = base + constraints[j].getP2();
+			offDiagonal[j] = -inverseMass(particles, shared) * glm::dot(directions[j], directions[j + 1]);
+		}
+
+		//Thomas algorithm: forward elimination...
+		for (int j = 1; j < n; j++) {
+			accumulator factor = offDiagonal[j - 1] / diagonal[j - 1];
+			diagonal[j] -= factor * offDiagonal[j - 1];
+			lambdas[j] -= factor * lambdas[j - 1];
+		}
+		//...and back substitution
+		lambdas[n - 1] /= diagonal[n - 1];
+		for (int j = n - 2; j >= 0; j--) {
+			lambdas[j] = (lambdas[j] - offDiagonal[j] * lambdas[j + 1]) / diagonal[j];
+		}
+
+		//apply the correction dx = W J^T lambda
+		for (int j = 0; j < n; j++) {
+			int a = base + constraints[j].getP1();
+			int b = base + constraints[j].getP2();
+			accumulatorVec3 correction = directions[j] * lambdas[j];
+			positions[a] = vec3(accumulatorVec3(positions[a]) - correction * inverseMass(particles, a));
+			positions[b] = vec3(accumulatorVec3(positions[b]) + correction * inverseMass(particles, b));
+		}
+	}
+};
@@ -1,111 +1,80 @@
 #pragma once
 #pragma once
 
+#include <algorithm>
+
 #include "PositionBasedObject.h"
+#include "CharacterTopology.h"
+#include "ProximityTracker.h"
 
 class Character : public PositionBasedObject {
 private:
 
 	//--------------------------------------- Private member variables -------------------------------------------
 	std::vector<vec3> normals;
-	int numberOfBaseConstraints;
-	int numberOfParticles;
+	std::vector<ShapeMatchingConstraint> shapeMatchingConstraints; // the body as one rigid group
 	float size;
 	float armLength;
 	vec3 startCenter;
 
 	bool isArmConnected = false;
+	std::vector<std::pair<int, int> > reachableParticles; // hand and rope particle pairs within the connection threshold
 
 	//--------------------------------------- Private methods ----------------------------------------------------
 	void initializePositions() {
 		//body
-		positions[0] = vec3(0.0, size, 0.0);			// A
-		positions[1] = vec3(size, 0.0, 0.0);			// B
-		positions[2] = vec3(0.0, -size, 0.0);			// C
-		positions[3] = vec3(-size, 0.0, 0.0);			// D
+		position(0) = vec3(0.0, size, 0.0);			// A
+		position(1) = vec3(size, 0.0, 0.0);			// B
+		position(2) = vec3(0.0, -size, 0.0);			// C
+		position(3) = vec3(-size, 0.0, 0.0);			// D
 					 
-		positions[4] = vec3(.6f*size, .6f*size, 0.0);		// E
-		positions[5] = vec3(.6f*size, -.6f*size, 0.0);		// F
-		positions[6] = vec3(-.6f*size, -.6f*size, 0.0);		// G
-		positions[7] = vec3(-.6f*size, .6f*size, 0.0);		// H
+		position(4) = vec3(.6f*size, .6f*size, 0.0);		// E
+		position(5) = vec3(.6f*size, -.6f*size, 0.0);		// F
+		position(6) = vec3(-.6f*size, -.6f*size, 0.0);		// G
+		position(7) = vec3(-.6f*size, .6f*size, 0.0);		// H
 		//arms		 
-		positions[8] = vec3(0.0, armLength * size, 0.0);
-		positions[9] = vec3(armLength * size, 0.0, 0.0);
-		positions[10] = vec3(0.0, -armLength * size, 0.0);
-		positions[11] = vec3(-armLength * size, 0.0, 0.0);
+		position(8) = vec3(0.0, armLength * size, 0.0);
+		position(9) = vec3(armLength * size, 0.0, 0.0);
+		position(10) = vec3(0.0, -armLength * size, 0.0);
+		position(11) = vec3(-armLength * size, 0.0, 0.0);
 		
-		for (int i = 0; i < positions.size(); i++) {
-			positions[i] += startCenter;
+		for (int i = 0; i < numberOfParticles; i++) {
+			position(i) += startCenter;
 		}
 	}
 
+	void initializeShapeMatching() {
+		std::vector<int> body;
+		for (int i = 0; i < CharacterTopology::numberOfBodyParticles; i++)
+			body.push_back(i);
+		shapeMatchingConstraints.push_back(ShapeMatchingConstraint(body, particles.positions, particles.masses, firstParticle, 1));
+	}
+
+	//in the order of CharacterTopology, which the unrolled constraint pass relies on
 	void initializeConstraints() {
-		// A,B,C,D
-		makeConstraint(0, 1);
-		makeConstraint(0, 2);
-		makeConstraint(0, 3);
-		makeConstraint(0, 4);
-		makeConstraint(0, 7);
-		makeConstraint(1, 2);
-		makeConstraint(1, 3);
-		makeConstraint(1, 4);
-		makeConstraint(1, 5);
-		makeConstraint(2, 3);
-		makeConstraint(2, 5);
-		makeConstraint(2, 6);
-		makeConstraint(3, 6);
-		makeConstraint(3, 7);
-		// E, F, G, H
-		makeConstraint(4, 5);
-		makeConstraint(4, 6);
-		makeConstraint(4, 7);
-		makeConstraint(5, 6);
-		makeConstraint(5, 7);
-		makeConstraint(6, 7);
-		//arms
-		makeConstraint(8, 0);
-		makeConstraint(8, 4);
-		makeConstraint(8, 7);
-		makeConstraint(9, 1);
-		makeConstraint(9, 4);
-		makeConstraint(9, 5);
-		makeConstraint(10, 2);
-		makeConstraint(10, 5);
-		makeConstraint(10, 6);
-		makeConstraint(11, 3);
-		makeConstraint(11, 6);
-		makeConstraint(11, 7);
-
-		makeConstraint(8, 10);
-		makeConstraint(9, 11);
-		numberOfBaseConstraints = constraints.size();
+		for (int j = 0; j < CharacterTopology::numberOfConstraints; j++) {
+			makeConstraint(CharacterTopology::constraint(j).p1, CharacterTopology::constraint(j).p2);
+		}
 	}
 
 public:
 	//--------------------------------------- Public methods -----------------------------------------------------
-	Character(IntegrationScheme integrationScheme, GLhandleARB shaderProgramId, float size, float armLength, vec3 startCenter) :
-		PositionBasedObject() {
+	Character(IntegrationScheme integrationScheme, ParticleStore & particles, GLhandleARB shaderProgramId, float size, float armLength, vec3 startCenter) :
+		PositionBasedObject(particles, CharacterTopology::numberOfParticles) {
 		this->size = size;
 		this->armLength = armLength;
 		this->startCenter = startCenter;
-		numberOfParticles = 12;
 
-		positions.resize(numberOfParticles);
-		oldPositions.resize(numberOfParticles);
-		accelerations.resize(numberOfParticles, vec3(0, 0, 0));
-
-		masses.resize(numberOfParticles, 1);
-		isMovables.resize(numberOfParticles, true);
-		velocities.resize(numberOfParticles, vec3(0, 0, 0));
-
-		solver = new Solver(integrationScheme, positions, oldPositions, velocities, accelerations, masses, isMovables, constraints);
-		renderer = new ParticleNetworkRenderer(shaderProgramId, positions, constraints, numberOfParticles);
+		solver = new Solver(integrationScheme, particles, firstParticle, numberOfParticles, constraints, connectors);
+		solver->setUnrolledConstraintKernel(&UnrolledConstraintSolverT<WorldPrecision, CharacterTopology>::solve<ConstraintIndex>);
+		renderer = new ParticleNetworkRenderer(shaderProgramId, particles.positions, firstParticle, constraints, numberOfParticles);
 
 		initializePositions();
-		for (int i = 0; i < positions.size(); i++) {
-			oldPositions[i] = positions[i];
+		for (int i = 0; i < numberOfParticles; i++) {
+			oldPosition(i) = position(i);
 		}
 		initializeConstraints();
+		initializeShapeMatching();
 
 		normals.resize(numberOfParticles, vec3(0, 0, 0));
 		renderer->setupOpenGLBuffers();
@@ -116,53 +85,93 @@ public:
 		solver->setIntegrationScheme(integrationScheme);
 		solver->setToFirstTimeStep();
 
-		std::fill(accelerations.begin(), accelerations.end(), vec3(0, 0, 0));
-		std::fill(velocities.begin(), velocities.end(), vec3(0, 0, 0));
-
-		oldPositions.resize(numberOfParticles);
+		for (int i = 0; i < numberOfParticles; i++) {
+			acceleration(i) = vec3(0, 0, 0);
+			velocity(i) = vec3(0, 0, 0);
+		}
 
 		initializePositions();
 
-		for (int i = 0; i < positions.size(); i++) {
-			oldPositions[i] = positions[i];
+		for (int i = 0; i < numberOfParticles; i++) {
+			oldPosition(i) = position(i);
 		}
+		for (ShapeMatchingConstraint & shape : shapeMatchingConstraints)
+			shape.resetRotation();
 	}
 
-	//try establishing a connection between a rope particle and a player arm
-	void tryConnectorConstraint(RopeManager* ropeMgr, float connectionThreshold) {
-		Particle closestParticle;
+	//With shape matching the body is restored in one pass and only the constraints of the arms are relaxed
+	void setShapeMatching(bool enabled) {
+		if (enabled) {
+			solver->setShapeMatching(&shapeMatchingConstraints, CharacterTopology::numberOfBodyConstraints);
+			solver->setUnrolledConstraintKernel(&UnrolledConstraintSolverT<WorldPrecision, CharacterArmTopology>::solve<ConstraintIndex>);
+		}
+		else {
+			solver->setShapeMatching(NULL, 0);
+			solver->setUnrolledConstraintKernel(&UnrolledConstraintSolverT<WorldPrecision, CharacterTopology>::solve<ConstraintIndex>);
+		}
+	}
+
+	//Only the body collides with other particles, the hands have to get close to the ropes to grab them
+	void setParticleRadius(SCALAR radius) {
+		for (int i = 0; i < numberOfParticles; i++) {
+			particles.radii[firstParticle + i] = i < CharacterTopology::numberOfBodyParticles ? radius : SCALAR(0);
+		}
+	}
+
+	void shiftOrigin(const vec3 & shift) {
+		PositionBasedObject::shiftOrigin(shift);
+		startCenter -= shift;
+	}
+
+	//center of the body particles
+	vec3 getCenter() {
+		vec3 center = vec3(0, 0, 0);
+		for (int i = 0; i < 8; i++) {
+			center += position(i);
+		}
+		return center / SCALAR(8);
+	}
+
+	//hand particles, global indices
+	std::vector<int> getHands() {
+		std::vector<int> hands;
+		for (int i = 8; i < 12; i++)
+			hands.push_back(firstParticle + i);
+		return hands;
+	}
+
+	//keeps track of the rope particles within reach of a hand
+	void handleProximityEvent(const ProximityEvent & event) {
+		std::pair<int, int> pair(event.seeker, event.target);
+		if (event.entered)
+			reachableParticles.push_back(pair);
+		else
+			reachableParticles.erase(std::remove(reachableParticles.begin(), reachableParticles.end(), pair), reachableParticles.end());
+	}
+
+	//try establishing a connection between the closest pair of a hand and a rope particle within reach
+	void tryConnectorConstraint() {
+		if (isArmConnected || reachableParticles.empty())
+			return;
+
+		std::pair<int, int> closestPair = reachableParticles[0];
 		float closestDistance = 9999.f;
-		closestParticle.id = -1;
-		int armId = -1;
-
-		if (!isArmConnected) {
-			//check each arm for closest particle. Save arm ID and corresponding Particle
-			for (int i = 0; i < 4; i++) {
-				//if arm is not already connected
-					Particle tempParticle = ropeMgr->getClosestParticle(positions[i + 8], connectionThreshold);
-					//check if this one is the closest pair of rope particle and arm
-					if (tempParticle.id != -1) {
-						float tempDistance = glm::distance(tempParticle.positions->at(tempParticle.id), positions[i + 8]);
-						if (tempDistance < closestDistance) {
-							closestParticle = tempParticle;
-							closestDistance = tempDistance;
-							armId = i+8;
-						}
-					}
-				}
+		for (std::pair<int, int> & pair : reachableParticles) {
+			float distance = glm::distance(particles.positions[pair.first], particles.positions[pair.second]);
+			if (distance < closestDistance) {
+				closestPair = pair;
+				closestDistance = distance;
 			}
-
-		// make constraint between arm and rope particle, if possible
-		if (closestParticle.id != -1 && armId != -1) {
-			makeConstraint(armId, positions, isMovables, closestParticle.id, *closestParticle.positions, *closestParticle.isMovables, 0);
-			isArmConnected = true;
 		}
+
+		// make constraint between arm and rope particle
+		makeConnector(closestPair.first - firstParticle, closestPair.second, 0);
+		isArmConnected = true;
 	}
 
 	void removeConnectorConstraints() {
-		int size = constraints.size();
-		if (size > numberOfBaseConstraints) {
-			constraints.erase(constraints.begin() + numberOfBaseConstraints, constraints.end());
+		if (!connectors.empty()) {
+			connectors.clear();
 			isArmConnected = false;
 		}
 	}
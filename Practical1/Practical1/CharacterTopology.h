@@ -0,0 +1,49 @@
+#pragma once
+
+#include "UnrolledSolver.h"
+
+// Particles and constraints of the character:
+//   0 - 3   A, B, C, D: top, right, bottom and left corner of the body
+//   4 - 7   E, F, G, H: inner ring of the body
+//   8 - 11  hands of the arms pointing up, right, down and left
+struct CharacterTopology {
+	static const int numberOfParticles = 12;
+	static const int numberOfConstraints = 34;
+	static const int firstConstraint = 0;
+	static const int numberOfBodyParticles = 8;
+	static const int numberOfBodyConstraints = 20; // the first 20 constraints only connect body particles
+
+	static constexpr ConstraintPair constraint(int j) {
+		const ConstraintPair constraints[numberOfConstraints] = {
+			// A,B,C,D
+			{ 0, 1 }, { 0, 2 }, { 0, 3 }, { 0, 4 }, { 0, 7 },
+			{ 1, 2 }, { 1, 3 }, { 1, 4 }, { 1, 5 },
+			{ 2, 3 }, { 2, 5 }, { 2, 6 },
+			{ 3, 6 }, { 3, 7 },
+			// E, F, G, H
+			{ 4, 5 }, { 4, 6 }, { 4, 7 },
+			{ 5, 6 }, { 5, 7 },
+			{ 6, 7 },
+			//arms
+			{ 8, 0 }, { 8, 4 }, { 8, 7 },
+			{ 9, 1 }, { 9, 4 }, { 9, 5 },
+			{ 10, 2 }, { 10, 5 }, { 10, 6 },
+			{ 11, 3 }, { 11, 6 }, { 11, 7 },
+
+			{ 8, 10 },
+			{ 9, 11 }
+		};
+		return constraints[j];
+	}
+};
+
+// Only the constraints that attach the arms, for when the body is held by shape matching.
+struct CharacterArmTopology {
+	static const int numberOfParticles = CharacterTopology::numberOfParticles;
+	static const int numberOfConstraints = CharacterTopology::numberOfConstraints - CharacterTopology::numberOfBodyConstraints;
+	static const int firstConstraint = CharacterTopology::numberOfBodyConstraints;
+
+	static constexpr ConstraintPair constraint(int j) {
+		return CharacterTopology::constraint(firstConstraint + j);
+	}
+};
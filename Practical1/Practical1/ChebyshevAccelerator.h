@@ -0,0 +1,144 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.h"
+
+// Chebyshev semi-iterative acceleration of the constraint iterations (Wang 2015). After the first warmUpIterations
+// plain passes every pass is extrapolated from the positions two passes before:
+//   q_k = omega_k * (q^_k - q_k-2) + q_k-2,   omega_k = 4 / (4 - rho^2 * omega_k-1)
+// where rho is the spectral radius of the plain iteration. rho is estimated from the ratio of successive residuals
+// during the warm-up passes and smoothed over the steps, with a single warm-up pass it keeps its initial value.
+// If an accelerated pass increases the residual the extrapolation is dropped for the rest of the step and the
+// estimate is lowered.
+// Every referenceInterval steps one step runs without acceleration and records the residual after each pass. The
+// passes saved by an accelerated step are the plain passes that reference needed to get to the same residual; past
+// its last pass the reference is extrapolated with the rate of its last two passes.
+template <typename P>
+class ChebyshevAcceleratorT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	scalar spectralRadius;
+	scalar maxSpectralRadius = scalar(0.95); // extrapolating with a radius close to 1 overshoots badly
+	int warmUpIterations;
+
+	std::vector<vec3> older, newer; // positions after pass k - 2 and k - 1 of the owned range
+	accumulator omega = 1;
+	accumulator previousResidual = 0;
+	bool diverged = false;
+
+	int referenceInterval = 64;
+	int stepCount = 0;
+	bool referenceStep = false;
+	std::vector<accumulator> referenceResiduals; // residual per pass of the last plain reference step
+	int iterationsSaved = 0;
+
+public:
+	ChebyshevAcceleratorT(scalar spectralRadius, int warmUpIterations) {
+		this->spectralRadius = spectralRadius;
+		this->warmUpIterations = glm::max(warmUpIterations, 1);
+	}
+
+	//Called after integration with the positions the first pass starts from:
+	void beginStep(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles) {
+		newer.assign(particles.positions.begin() + firstParticle, particles.positions.begin() + firstParticle + numberOfParticles);
+		older = newer;
+		omega = 1;
+		previousResidual = 0;
+		diverged = false;
+
+		referenceStep = stepCount++ % referenceInterval == 0;
+		if (referenceStep)
+			referenceResiduals.clear();
+	}
+
+	//Called after constraint pass number iteration (starting at 1), residual is the violation found during that pass
+	void accelerate(ParticleStoreT<P> & particles, int firstParticle, int iteration, accumulator residual) {
+		std::vector<vec3> & positions = particles.positions;
+		int numberOfParticles = (int)newer.size();
+
+		if (referenceStep) {
+			referenceResiduals.push_back(residual);
+			omega = 1;
+		}
+		else if (iteration <= warmUpIterations) {
+			if (iteration > 1 && previousResidual > 0 && residual < previousResidual) {
+				scalar ratio = scalar(residual / previousResidual);
+				spectralRadius = glm::min(scalar(0.9) * spectralRadius + scalar(0.1) * ratio, maxSpectralRadius);
+			}
+			omega = 1;
+		}
+		else if (diverged || residual > previousResidual) {
+			if (!diverged)
+				spectralRadius *= scalar(0.9);
+			diverged = true;
+			omega = 1;
+		}
+		else {
+			accumulator rhoSquared = accumulator(spectralRadius) * spectralRadius;
+			omega = iteration == warmUpIterations + 1 ? 2 / (2 - rhoSquared) : 4 / (4 - rhoSquared * omega);
+		}
+		previousResidual = residual;
+
+		if (omega != accumulator(1)) {
+			for (int i = 0; i < numberOfParticles; i++) {
+				if (particles.isMovables[firstParticle + i]) {
+					accumulatorVec3 base = accumulatorVec3(older[i]);
+					positions[firstParticle + i] = vec3(omega * (accumulatorVec3(positions[firstParticle + i]) - base) + base);
+				}
+			}
+		}
+
+		older.swap(newer);
+		newer.assign(positions.begin() + firstParticle, positions.begin() + firstParticle + numberOfParticles);
+	}
+
+	//Called once the passes of a step are done:
+	void endStep(int iterations) {
+		if (referenceStep || referenceResiduals.empty() || previousResidual <= 0)
+			return;
+		int numberOfReferences = (int)referenceResiduals.size();
+		int plainIterations = -1;
+		for (int k = 0; k < numberOfReferences; k++) {
+			if (referenceResiduals[k] <= previousResidual) {
+				plainIterations = k + 1;
+				break;
+			}
+		}
+		if (plainIterations < 0) {
+			//extrapolate, but never count more than four times the reference so a stalled reference does not dominate
+			plainIterations = 4 * numberOfReferences;
+			if (numberOfReferences > 1) {
+				accumulator last = referenceResiduals[numberOfReferences - 1];
+				accumulator rate = last / referenceResiduals[numberOfReferences - 2];
+				if (last > 0 && rate < accumulator(1)) {
+					double extraIterations = std::log(double(previousResidual / last)) / std::log(double(rate));
+					plainIterations = glm::min(numberOfReferences + (int)std::ceil(extraIterations), plainIterations);
+				}
+			}
+		}
+		if (plainIterations > iterations)
+			iterationsSaved += plainIterations - iterations;
+	}
+
+	scalar getSpectralRadius() {
+		return spectralRadius;
+	}
+
+	//constraint passes saved since the last reset
+	int getIterationsSaved() {
+		return iterationsSaved;
+	}
+
+	void resetIterationsSaved() {
+		iterationsSaved = 0;
+	}
+};
+
+typedef ChebyshevAcceleratorT<WorldPrecision> ChebyshevAccelerator;
@@ -1,29 +1,57 @@
 #pragma once
 
-#ifdef DOUBLE_PRECISION
-typedef glm::dvec3 vec3;
-#define SCALAR double
-#define GL_SCALAR GL_DOUBLE
-#else
-typedef glm::vec3 vec3;
-#define SCALAR float
-#define GL_SCALAR GL_FLOAT
-#endif
-
-class Collider {
+#include <vector>
+#include <limits>
+
+#include "Precision.h"
+#include "Renderer.h"
+
+template <typename P>
+class ColliderT {
 private:
 	bool active = true;
 
 public: 
 	Renderer * renderer;
 
-	Collider() {}
+	ColliderT() {}
 
-	~Collider() {
+	virtual ~ColliderT() {
 		delete(renderer);
 	}
 
-	virtual void handleCollision(vec3 & particlePosition) {}
+	virtual void handleCollision(typename P::vec3 & particlePosition) {}
+
+	//Handles the particles with the given global indices in turn. Colliders with an acceleration structure query
+	//all of them together instead.
+	virtual void handleCollisions(std::vector<typename P::vec3> & positions, const std::vector<int> & particles) {
+		for (int i : particles)
+			handleCollision(positions[i]);
+	}
+
+	//Distance of the position outside the collider, 0 or less inside. Colliders that cannot tell return the lowest
+	//value, so every particle stays a candidate for them.
+	virtual typename P::scalar getDistance(const typename P::vec3 &) {
+		return std::numeric_limits<typename P::scalar>::lowest();
+	}
+
+	//getDistance of the particles with the given global indices
+	virtual void getDistances(const std::vector<typename P::vec3> & positions, const std::vector<int> & particles,
+		std::vector<typename P::scalar> & distances) {
+		distances.resize(particles.size());
+		for (int k = 0; k < (int)particles.size(); k++)
+			distances[k] = getDistance(positions[particles[k]]);
+	}
+
+	//Thinnest extent of the collider, a particle moving further than this in one step can tunnel through it.
+	//Half spaces cannot be tunneled through.
+	virtual typename P::scalar getThickness() {
+		return std::numeric_limits<typename P::scalar>::max();
+	}
+
+	virtual void shiftOrigin(const typename P::vec3 & shift) {
+		renderer->shiftOrigin(::vec3(shift));
+	}
 
 	bool isActive() {
 		return active;
@@ -32,4 +60,6 @@ public:
 	void setActive(bool active) {
 		this->active = active;
 	}
-};
\ No newline at end of file
+};
+
+typedef ColliderT<WorldPrecision> Collider;
@@ -1,83 +1,89 @@
 #pragma once
 
-#ifdef DOUBLE_PRECISION
-typedef glm::dvec3 vec3;
-#define SCALAR double
-#define GL_SCALAR GL_DOUBLE
-#else
-typedef glm::vec3 vec3;
-#define SCALAR float
-#define GL_SCALAR GL_FLOAT
-#endif
+#include <vector>
+
+#include "Precision.h"
 
-class Constraint {
+// A distance constraint is only two particle indices and a rest length. The indices are relative to a base index
+// given when solving: the first particle of the owning object, or 0 for connectors between objects, which use
+// global indices into the ParticleStore.
+template <typename P, typename Index = unsigned int>
+class ConstraintT {
 private:
-	SCALAR restDistance; // the length between particle p1 and p2 in rest configuration
-	int p1, p2; // the two particles that are connected through this constraint
-	std::vector<vec3> & positions1, & positions2;
-	std::vector<bool> & isMovables1, & isMovables2;
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
 
-public:
-	Constraint(int p1, int p2, std::vector<vec3> & positions, std::vector<bool> & isMovables)
-		: positions1(positions), isMovables1(isMovables),
-		positions2(positions), isMovables2(isMovables) {
+	Index p1, p2; // the two particles that are connected through this constraint
+	scalar restDistance; // the length between particle p1 and p2 in rest configuration
 
+public:
+	ConstraintT(Index p1, Index p2, scalar restDistance) {
 		this->p1 = p1;
 		this->p2 = p2;
-
-		vec3 vec = positions1[p1] - positions2[p2];
-		restDistance = glm::length(vec);
+		this->restDistance = restDistance;
 	}
 
-
-
-	Constraint(	int p1, std::vector<vec3> & positions1, std::vector<bool> & isMovables1, 
-				int p2, std::vector<vec3> & positions2, std::vector<bool> & isMovables2)
-				:	positions1(positions1), isMovables1(isMovables1),
-					positions2(positions2), isMovables2(isMovables2) {
-
+	ConstraintT(Index p1, Index p2, const std::vector<vec3> & positions, int base) {
 		this->p1 = p1;
 		this->p2 = p2;
-
-		vec3 vec = positions1[p1] - positions2[p2];
-		restDistance = glm::length(vec);
+		restDistance = glm::length(positions[base + p1] - positions[base + p2]);
 	}
 
-	Constraint(int p1, std::vector<vec3> & positions1, std::vector<bool> & isMovables1,
-		int p2, std::vector<vec3> & positions2, std::vector<bool> & isMovables2, SCALAR restDistance)
-		: positions1(positions1), isMovables1(isMovables1),
-		positions2(positions2), isMovables2(isMovables2) {
-
-		this->p1 = p1;
-		this->p2 = p2;
-		this->restDistance = restDistance;
+	//Projects both particles and returns the violation |length - restDistance| before the projection
+	inline accumulator solveConstraint(std::vector<vec3> & positions, const std::vector<bool> & isMovables, int base) {
+		int i1 = base + p1;
+		int i2 = base + p2;
+		accumulatorVec3 vec = accumulatorVec3(positions[i1]) - accumulatorVec3(positions[i2]);
+		accumulator length = glm::length(vec);
+		if (length == accumulator(0))
+			return accumulator(restDistance);
+		accumulatorVec3 correction = accumulator(0.5) * (length - accumulator(restDistance)) / length * vec;
+		if (isMovables[i1])
+			positions[i1] = vec3(accumulatorVec3(positions[i1]) - correction);
+		if (isMovables[i2])
+			positions[i2] = vec3(accumulatorVec3(positions[i2]) + correction);
+		return glm::abs(length - accumulator(restDistance));
 	}
 
-	Constraint& operator=(const Constraint& c) {
-		this->p1 = c.p1;
-		this->p2 = c.p2;
-		this->positions1 = c.positions1;
-		this->positions2 = c.positions2;
-		this->isMovables1 = c.isMovables1;
-		this->isMovables2 = c.isMovables2;
-		return *this;
+	//|length - restDistance| without moving the particles
+	inline accumulator getViolation(const std::vector<vec3> & positions, int base) {
+		accumulatorVec3 vec = accumulatorVec3(positions[base + p1]) - accumulatorVec3(positions[base + p2]);
+		return glm::abs(glm::length(vec) - accumulator(restDistance));
 	}
 
-	void solveConstraints() {
-		glm::vec3 vec = positions1[p1] - positions2[p2];
-		if (isMovables1[p1])
-			positions1[p1] += - 0.5f *(glm::length(vec) - restDistance) * glm::normalize(vec);
-		if(isMovables2[p2])
-			positions2[p2] += 0.5f *(glm::length(vec) - restDistance) * glm::normalize(vec);
+	//Unilateral version used for long range attachments: only acts once the particles are further apart than
+	//restDistance, and a pinned particle leaves the whole correction to the other one
+	inline accumulator solveMaxDistance(std::vector<vec3> & positions, const std::vector<bool> & isMovables, int base) {
+		int i1 = base + p1;
+		int i2 = base + p2;
+		accumulatorVec3 vec = accumulatorVec3(positions[i1]) - accumulatorVec3(positions[i2]);
+		accumulator length = glm::length(vec);
+		if (length <= accumulator(restDistance))
+			return accumulator(0);
+		accumulator w1 = isMovables[i1] ? accumulator(1) : accumulator(0);
+		accumulator w2 = isMovables[i2] ? accumulator(1) : accumulator(0);
+		if (w1 + w2 == accumulator(0))
+			return accumulator(0);
+		accumulatorVec3 correction = (length - accumulator(restDistance)) / (length * (w1 + w2)) * vec;
+		positions[i1] = vec3(accumulatorVec3(positions[i1]) - w1 * correction);
+		positions[i2] = vec3(accumulatorVec3(positions[i2]) + w2 * correction);
+		return length - accumulator(restDistance);
 	}
 
-
 	inline int getP1() { return p1; }
 	inline int getP2() { return p2; }
+	inline scalar getRestDistance() { return restDistance; }
+};
 
-	bool isConnector() {
-		if (positions1 != positions2)
-			return true;
-		return false;
-	}
-};
\ No newline at end of file
+// Constraints inside an object use indices relative to the object. With COMPACT_CONSTRAINT_INDICES they are
+// stored in 16 bit, which limits objects to 65536 particles.
+#ifdef COMPACT_CONSTRAINT_INDICES
+typedef unsigned short ConstraintIndex;
+#else
+typedef unsigned int ConstraintIndex;
+#endif
+
+typedef ConstraintT<WorldPrecision, ConstraintIndex> Constraint;
+typedef ConstraintT<WorldPrecision, unsigned int> ConnectorConstraint;
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <limits>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <glm/glm.hpp>
+
+#include "Platform.h"
+#include "Collider.h"
+
+// File layout of a distance grid: this header followed by the distances as 32 bit floats with x running fastest,
+// so a grid file can be mapped into memory and sampled in place.
+struct DistanceGridHeader {
+	char magic[4]; // "SDFG"
+	int32_t version;
+	int32_t size[3]; // samples along x, y and z, a grid with 1 sample in z extends infinitely in z like the boxes
+	float origin[3]; // position of the first sample
+	float cellSize;
+	float thickness; // thinnest feature of the geometry, see ColliderT::getThickness
+};
+
+// Signed distances to static geometry sampled on a regular grid, negative inside. A query costs one trilinear
+// lookup of the 8 samples around the position no matter how complex the geometry is, and the same 8 samples give
+// the gradient. Grids are baked from colliders that know their distance, saved to a file once and mapped from it.
+// Outside of the grid the distance grows with the distance to the grid, the geometry has to lie inside of it.
+template <typename P>
+class DistanceGridT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	static const int32_t VERSION = 1;
+
+	DistanceGridHeader header;
+	glm::ivec3 size;
+	accumulatorVec3 origin; // moves with the floating origin, the header keeps the baked one
+	const float * distances;
+	std::vector<float> ownDistances; // for grids that are not mapped
+	MappedFile mappedFile; // for grids that are
+
+	DistanceGridT() {}
+
+	DistanceGridT(const DistanceGridT &) = delete;
+	DistanceGridT & operator=(const DistanceGridT &) = delete;
+
+	void setHeader(const DistanceGridHeader & header) {
+		this->header = header;
+		size = glm::ivec3(header.size[0], header.size[1], header.size[2]);
+		origin = accumulatorVec3(header.origin[0], header.origin[1], header.origin[2]);
+	}
+
+	int numberOfSamples() {
+		return size.x * size.y * size.z;
+	}
+
+public:
+	//A grid of the given number of samples, all at distance 0
+	DistanceGridT(glm::ivec3 size, vec3 origin, scalar cellSize) {
+		DistanceGridHeader header = { { 'S', 'D', 'F', 'G' }, VERSION, { size.x, size.y, size.z },
+			{ float(origin.x), float(origin.y), float(origin.z) }, float(cellSize), std::numeric_limits<float>::max() };
+		setHeader(header);
+		ownDistances.assign(numberOfSamples(), 0.f);
+		distances = ownDistances.data();
+	}
+
+	~DistanceGridT() {
+		unmapFile(mappedFile);
+	}
+
+	//Samples the union of the colliders between lower and upper, a grid with lower.z == upper.z is 2D. Colliders
+	//that cannot tell their distance are left out.
+	static DistanceGridT * bake(const std::vector<ColliderT<P>*> & colliders, vec3 lower, vec3 upper, scalar cellSize) {
+		glm::ivec3 size = glm::ivec3(glm::ceil((upper - lower) / cellSize)) + 1;
+		DistanceGridT * grid = new DistanceGridT(size, lower, cellSize);
+
+		//far from everything the distance is capped, the grid only has to tell inside from outside there
+		float farAway = float(glm::length(upper - lower) + cellSize);
+		float thickness = std::numeric_limits<float>::max();
+		std::vector<ColliderT<P>*> sources;
+		for (ColliderT<P>* collider : colliders) {
+			if (collider->getDistance(lower) != std::numeric_limits<scalar>::lowest()) {
+				sources.push_back(collider);
+				thickness = glm::min(thickness, float(collider->getThickness()));
+			}
+		}
+		grid->header.thickness = thickness;
+
+		int rows = size.y * size.z;
+		#pragma omp parallel for if (rows > 64)
+		for (int row = 0; row < rows; row++) {
+			int y = row % size.y, z = row / size.y;
+			for (int x = 0; x < size.x; x++) {
+				vec3 position = lower + cellSize * vec3(x, y, z);
+				float distance = farAway;
+				for (ColliderT<P>* collider : sources)
+					distance = glm::min(distance, float(collider->getDistance(position)));
+				grid->ownDistances[x + size.x * row] = distance;
+			}
+		}
+		return grid;
+	}
+
+	//Maps a grid file written by save, returns nullptr if it cannot be read
+	static DistanceGridT * map(const std::string & filename) {
+		DistanceGridT * grid = new DistanceGridT();
+		if (!mapFile(filename, grid->mappedFile)) {
+			std::cout << "Sorry, can't map distance grid: " << filename << std::endl;
+			delete grid;
+			return nullptr;
+		}
+
+		DistanceGridHeader header;
+		bool valid = grid->mappedFile.size >= sizeof(header);
+		if (valid) {
+			std::memcpy(&header, grid->mappedFile.data, sizeof(header));
+			valid = std::memcmp(header.magic, "SDFG", 4) == 0 && header.version == VERSION
+				&& header.size[0] > 0 && header.size[1] > 0 && header.size[2] > 0 && header.cellSize > 0;
+		}
+		if (valid) {
+			grid->setHeader(header);
+			valid = grid->mappedFile.size >= sizeof(header) + grid->numberOfSamples() * sizeof(float);
+		}
+		if (!valid) {
+			std::cout << "Not a distance grid: " << filename << std::endl;
+			delete grid;
+			return nullptr;
+		}
+		grid->distances = reinterpret_cast<const float *>(static_cast<const char *>(grid->mappedFile.data) + sizeof(header));
+		return grid;
+	}
+
+	bool save(const std::string & filename) {
+		FILE * file = std::fopen(filename.c_str(), "wb");
+		if (file == nullptr) {
+			std::cout << "Sorry, can't write distance grid: " << filename << std::endl;
+			return false;
+		}
+		bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+			&& std::fwrite(distances, sizeof(float), numberOfSamples(), file) == (size_t)numberOfSamples();
+		std::fclose(file);
+		return written;
+	}
+
+	//Trilinear interpolation of the distance at the position and its gradient
+	accumulator sample(const accumulatorVec3 & position, accumulatorVec3 & gradient) const {
+		accumulatorVec3 local = (position - origin) / accumulator(header.cellSize);
+		for (int axis = 0; axis < 3; axis++) {
+			if (size[axis] == 1)
+				local[axis] = 0;
+		}
+		accumulatorVec3 clamped = glm::clamp(local, accumulatorVec3(0), accumulatorVec3(size - 1));
+		glm::ivec3 cell = glm::min(glm::ivec3(clamped), glm::max(size - 2, glm::ivec3(0)));
+		accumulatorVec3 f = clamped - accumulatorVec3(cell);
+
+		//an axis with a single sample reads the same sample twice and has no gradient
+		glm::ivec3 step = glm::min(size - 1, glm::ivec3(1));
+		int dx = step.x, dy = step.y * size.x, dz = step.z * size.x * size.y;
+		const float * corner = distances + cell.x + size.x * (cell.y + size.y * cell.z);
+		accumulator c000 = corner[0], c100 = corner[dx], c010 = corner[dy], c110 = corner[dx + dy];
+		accumulator c001 = corner[dz], c101 = corner[dx + dz], c011 = corner[dy + dz], c111 = corner[dx + dy + dz];
+
+		accumulator c00 = glm::mix(c000, c100, f.x), c10 = glm::mix(c010, c110, f.x);
+		accumulator c01 = glm::mix(c001, c101, f.x), c11 = glm::mix(c011, c111, f.x);
+		accumulator c0 = glm::mix(c00, c10, f.y), c1 = glm::mix(c01, c11, f.y);
+		accumulator distance = glm::mix(c0, c1, f.z);
+
+		gradient.x = glm::mix(glm::mix(c100 - c000, c110 - c010, f.y), glm::mix(c101 - c001, c111 - c011, f.y), f.z);
+		gradient.y = glm::mix(c10 - c00, c11 - c01, f.z);
+		gradient.z = c1 - c0;
+		gradient /= accumulator(header.cellSize);
+
+		accumulatorVec3 outside = (local - clamped) * accumulator(header.cellSize);
+		accumulator outsideDistance = glm::length(outside);
+		if (outsideDistance > 0) {
+			distance += outsideDistance;
+			gradient = outside / outsideDistance;
+		}
+		return distance;
+	}
+
+	//the sample at grid position x y z
+	float getDistance(int x, int y, int z) const {
+		return distances[x + size.x * (y + size.y * z)];
+	}
+
+	glm::ivec3 getSize() const {
+		return size;
+	}
+
+	accumulatorVec3 getOrigin() const {
+		return origin;
+	}
+
+	scalar getCellSize() const {
+		return scalar(header.cellSize);
+	}
+
+	scalar getThickness() const {
+		return header.thickness == std::numeric_limits<float>::max() ? std::numeric_limits<scalar>::max() : scalar(header.thickness);
+	}
+
+	void shiftOrigin(const vec3 & shift) {
+		origin -= accumulatorVec3(shift);
+	}
+};
+
+typedef DistanceGridT<WorldPrecision> DistanceGrid;
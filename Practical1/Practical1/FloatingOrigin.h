@@ -0,0 +1,44 @@
+#pragma once
+
+#include <iostream>
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+
+// Keeps simulation coordinates small by moving the origin to the player once the player got further than
+// rebaseDistance away from it. The absolute position of the origin is accumulated in double, so objects only
+// ever see coordinates relative to it and single precision stays accurate on arbitrarily long levels.
+class FloatingOrigin {
+private:
+	glm::dvec3 origin = glm::dvec3(0, 0, 0);
+	SCALAR rebaseDistance;
+	int numberOfRebases = 0;
+
+public:
+	FloatingOrigin(SCALAR rebaseDistance) {
+		this->rebaseDistance = rebaseDistance;
+	}
+
+	//Returns true if the world has to be shifted by -shift to bring the player back to the origin.
+	bool update(const vec3 & playerPosition, vec3 & shift) {
+		if (glm::length(playerPosition) < rebaseDistance)
+			return false;
+
+		shift = playerPosition;
+		origin += glm::dvec3(shift);
+		numberOfRebases++;
+		return true;
+	}
+
+	glm::dvec3 getOrigin() {
+		return origin;
+	}
+
+	glm::dvec3 toAbsolute(const vec3 & position) {
+		return origin + glm::dvec3(position);
+	}
+
+	int getNumberOfRebases() {
+		return numberOfRebases;
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+
+#include "Platform.h"
+
+enum PacingMode { sleepAndSpin, vsyncPacing };
+
+// Holds the main loop to a fixed frame period. The bulk of the wait is a coarse sleep, the last few hundred
+// microseconds are spent spinning because sleep_for may overshoot by a whole scheduler tick.
+class FramePacer {
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::duration framePeriod;
+	Clock::duration spinThreshold;
+	Clock::time_point deadline;
+	Clock::time_point lastFrameEnd;
+	PacingMode mode = sleepAndSpin;
+
+	double lastFrameTime = 0.0;		// seconds between the last two frames
+	double lastOverrun = 0.0;		// seconds by which the last missed deadline was missed
+	int missedDeadlines = 0;
+
+	static Clock::duration toDuration(double seconds) {
+		return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+	}
+
+public:
+	FramePacer(double framePeriod, double spinThreshold) {
+		this->framePeriod = toDuration(framePeriod);
+		this->spinThreshold = toDuration(spinThreshold);
+		//a coarse timer would make the coarse sleep useless
+		beginHighResolutionTimer();
+		lastFrameEnd = Clock::now();
+		deadline = lastFrameEnd + this->framePeriod;
+	}
+
+	~FramePacer() {
+		endHighResolutionTimer();
+	}
+
+	//Waits until the end of the current frame period. Returns false if the deadline had already passed.
+	bool waitForNextFrame() {
+		bool deadlineMet = true;
+		Clock::time_point now = Clock::now();
+
+		if (mode == vsyncPacing) {
+			//buffer swapping blocks on the display, a frame counts as missed once it took more than 1.5 periods
+			deadlineMet = (now - lastFrameEnd) * 2 <= framePeriod * 3;
+			if (!deadlineMet)
+				lastOverrun = std::chrono::duration<double>(now - lastFrameEnd - framePeriod).count();
+		}
+		else if (now >= deadline) {
+			//do not try to catch up on lost time, restart the schedule from now
+			deadlineMet = false;
+			lastOverrun = std::chrono::duration<double>(now - deadline).count();
+			deadline = now;
+		}
+		else {
+			if (deadline - now > spinThreshold)
+				std::this_thread::sleep_for(deadline - now - spinThreshold);
+			while (Clock::now() < deadline) {
+			}
+		}
+
+		if (!deadlineMet)
+			missedDeadlines++;
+
+		now = Clock::now();
+		lastFrameTime = std::chrono::duration<double>(now - lastFrameEnd).count();
+		lastFrameEnd = now;
+		deadline += framePeriod;
+		return deadlineMet;
+	}
+
+	void setFramePeriod(double framePeriod) {
+		this->framePeriod = toDuration(framePeriod);
+		deadline = Clock::now() + this->framePeriod;
+	}
+
+	//in vsync mode the caller is responsible for enabling the swap interval, the pacer only keeps statistics
+	void setMode(PacingMode mode) {
+		this->mode = mode;
+		lastFrameEnd = Clock::now();
+		deadline = lastFrameEnd + framePeriod;
+	}
+
+	PacingMode getMode() {
+		return mode;
+	}
+
+	double getLastFrameTime() {
+		return lastFrameTime;
+	}
+
+	double getLastOverrun() {
+		return lastOverrun;
+	}
+
+	int getMissedDeadlines() {
+		return missedDeadlines;
+	}
+};
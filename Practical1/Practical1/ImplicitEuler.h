@@ -0,0 +1,192 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Constraint.h"
+#include "ParticleStore.h"
+
+// Backward Euler step (Baraff and Witkin 1998) that treats the distance constraints of an object as stiff damped
+// springs. The velocity change solves
+//   (M + h D + h^2 K) dv = h (f - h K v)
+// with K and D the stiffness and damping matrices of the springs, afterwards v += dv and x += h v. The system is
+// never assembled: every spring keeps its 3x3 block h^2 K_s + h D_s and the product is gathered per particle over
+// the springs it belongs to, so it can run in parallel over the particles. It is solved with conjugate gradients,
+// preconditioned with the diagonal of the system. Pinned particles keep a velocity change of 0.
+template <typename P>
+class ImplicitEulerSolverT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+	typedef glm::mat<3, 3, accumulator> accumulatorMat3;
+
+	//springs of every particle as (spring, other particle), in compressed rows
+	std::vector<int> adjacencyStart;
+	std::vector<int> adjacentSprings, adjacentParticles;
+	int adjacencyConstraints = -1;
+
+	std::vector<accumulatorMat3> springBlocks; // h^2 K_s + h D_s
+	std::vector<accumulatorVec3> forces, rightHandSide, velocityChange, residual, direction, product, preconditioner, preconditioned;
+	std::vector<accumulator> mask; // 1 for movable, 0 for pinned particles
+
+	int maxIterations = 50;
+	accumulator tolerance = accumulator(1.0e-6); // relative to the initial residual
+	int lastIterations = 0;
+
+	template <typename Index>
+	void buildAdjacency(std::vector<ConstraintT<P, Index> > & constraints, int numberOfParticles) {
+		adjacencyStart.assign(numberOfParticles + 1, 0);
+		for (ConstraintT<P, Index> & constraint : constraints) {
+			adjacencyStart[constraint.getP1() + 1]++;
+			adjacencyStart[constraint.getP2() + 1]++;
+		}
+		for (int i = 0; i < numberOfParticles; i++)
+			adjacencyStart[i + 1] += adjacencyStart[i];
+
+		std::vector<int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		adjacentSprings.resize(adjacencyStart[numberOfParticles]);
+		adjacentParticles.resize(adjacencyStart[numberOfParticles]);
+		for (int s = 0; s < (int)constraints.size(); s++) {
+			int a = constraints[s].getP1(), b = constraints[s].getP2();
+			adjacentSprings[fill[a]] = s;
+			adjacentParticles[fill[a]++] = b;
+			adjacentSprings[fill[b]] = s;
+			adjacentParticles[fill[b]++] = a;
+		}
+		adjacencyConstraints = (int)constraints.size();
+	}
+
+	//product = (M + h D + h^2 K) p, masked to the movable particles
+	void multiply(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles, std::vector<accumulatorVec3> & p) {
+		#pragma omp parallel for if (numberOfParticles > 256)
+		for (int i = 0; i < numberOfParticles; i++) {
+			accumulatorVec3 value = accumulator(particles.masses[firstParticle + i]) * p[i];
+			for (int k = adjacencyStart[i]; k < adjacencyStart[i + 1]; k++)
+				value += springBlocks[adjacentSprings[k]] * (p[i] - p[adjacentParticles[k]]);
+			product[i] = mask[i] * value;
+		}
+	}
+
+	static accumulator dot(std::vector<accumulatorVec3> & a, std::vector<accumulatorVec3> & b) {
+		accumulator sum = 0;
+		for (int i = 0; i < (int)a.size(); i++)
+			sum += glm::dot(a[i], b[i]);
+		return sum;
+	}
+
+public:
+	template <typename Index>
+	void step(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles, std::vector<ConstraintT<P, Index> > & constraints,
+		accumulator timeStepSize, accumulator damping, scalar stiffness, scalar dampingStiffness) {
+		std::vector<vec3> & positions = particles.positions;
+		std::vector<vec3> & velocities = particles.velocities;
+		int n = numberOfParticles;
+		accumulator h = timeStepSize;
+
+		if (adjacencyConstraints != (int)constraints.size())
+			buildAdjacency(constraints, n);
+
+		forces.resize(n);
+		mask.resize(n);
+		for (int i = 0; i < n; i++) {
+			int global = firstParticle + i;
+			mask[i] = accumulator(particles.isMovables[global]);
+			velocities[global] = vec3(accumulatorVec3(velocities[global]) * damping);
+			forces[i] = accumulator(particles.masses[global]) * accumulatorVec3(particles.accelerations[global]);
+		}
+
+		//spring forces and blocks, compression is left out of the transverse stiffness so every block stays definite
+		springBlocks.resize(constraints.size());
+		for (int s = 0; s < (int)constraints.size(); s++) {
+			int a = firstParticle + constraints[s].getP1(), b = firstParticle + constraints[s].getP2();
+			accumulatorVec3 vec = accumulatorVec3(positions[a]) - accumulatorVec3(positions[b]);
+			accumulator length = glm::length(vec);
+			if (length == accumulator(0)) {
+				springBlocks[s] = accumulatorMat3(0);
+				continue;
+			}
+			accumulatorVec3 normal = vec / length;
+			accumulator restDistance = constraints[s].getRestDistance();
+			accumulatorVec3 relativeVelocity = accumulatorVec3(velocities[a]) - accumulatorVec3(velocities[b]);
+			accumulatorVec3 force = -(accumulator(stiffness) * (length - restDistance) + accumulator(dampingStiffness) * glm::dot(relativeVelocity, normal)) * normal;
+			forces[constraints[s].getP1()] += force;
+			forces[constraints[s].getP2()] -= force;
+
+			accumulatorMat3 normalProduct = glm::outerProduct(normal, normal);
+			accumulator transverse = glm::max(accumulator(0), accumulator(1) - restDistance / length);
+			accumulatorMat3 springStiffness = accumulator(stiffness) * (normalProduct + transverse * (accumulatorMat3(1) - normalProduct));
+			springBlocks[s] = h * h * springStiffness + h * accumulator(dampingStiffness) * normalProduct;
+		}
+
+		//right hand side h (f - h K v): h^2 K v is the stiffness part of the blocks applied to v
+		rightHandSide.resize(n);
+		velocityChange.assign(n, accumulatorVec3(0, 0, 0));
+		residual.resize(n);
+		direction.resize(n);
+		product.resize(n);
+		preconditioner.resize(n);
+		preconditioned.resize(n);
+		for (int i = 0; i < n; i++) {
+			accumulatorVec3 stiffnessTimesVelocity = accumulatorVec3(0, 0, 0);
+			accumulatorVec3 diagonal = accumulatorVec3(particles.masses[firstParticle + i]);
+			for (int k = adjacencyStart[i]; k < adjacencyStart[i + 1]; k++) {
+				int s = adjacentSprings[k];
+				int a = firstParticle + constraints[s].getP1(), b = firstParticle + constraints[s].getP2();
+				accumulatorVec3 vec = accumulatorVec3(positions[a]) - accumulatorVec3(positions[b]);
+				accumulator length = glm::length(vec);
+				if (length > accumulator(0)) {
+					accumulatorVec3 normal = vec / length;
+					accumulatorMat3 stiffnessBlock = springBlocks[s] - h * accumulator(dampingStiffness) * glm::outerProduct(normal, normal);
+					stiffnessTimesVelocity += stiffnessBlock * (accumulatorVec3(velocities[firstParticle + i]) - accumulatorVec3(velocities[firstParticle + adjacentParticles[k]]));
+				}
+				diagonal += accumulatorVec3(springBlocks[s][0][0], springBlocks[s][1][1], springBlocks[s][2][2]);
+			}
+			rightHandSide[i] = mask[i] * (h * forces[i] - stiffnessTimesVelocity);
+			preconditioner[i] = accumulator(1) / diagonal;
+		}
+
+		//preconditioned conjugate gradients, starting from dv = 0
+		residual = rightHandSide;
+		for (int i = 0; i < n; i++)
+			preconditioned[i] = preconditioner[i] * residual[i];
+		direction = preconditioned;
+		accumulator residualDotPreconditioned = dot(residual, preconditioned);
+		accumulator initialResidual = dot(residual, residual);
+		lastIterations = 0;
+
+		while (lastIterations < maxIterations && dot(residual, residual) > tolerance * tolerance * initialResidual && residualDotPreconditioned > 0) {
+			multiply(particles, firstParticle, n, direction);
+			accumulator directionDotProduct = dot(direction, product);
+			if (directionDotProduct <= accumulator(0))
+				break;
+			accumulator alpha = residualDotPreconditioned / directionDotProduct;
+			for (int i = 0; i < n; i++) {
+				velocityChange[i] += alpha * direction[i];
+				residual[i] -= alpha * product[i];
+				preconditioned[i] = preconditioner[i] * residual[i];
+			}
+			accumulator newResidualDotPreconditioned = dot(residual, preconditioned);
+			accumulator beta = newResidualDotPreconditioned / residualDotPreconditioned;
+			residualDotPreconditioned = newResidualDotPreconditioned;
+			for (int i = 0; i < n; i++)
+				direction[i] = preconditioned[i] + beta * direction[i];
+			lastIterations++;
+		}
+
+		//v += dv, x += h v
+		for (int i = 0; i < n; i++) {
+			int global = firstParticle + i;
+			accumulatorVec3 velocity = mask[i] * (accumulatorVec3(velocities[global]) + velocityChange[i]);
+			particles.advancePosition(global, particles.accumulatedPosition(global) + h * velocity);
+			velocities[global] = vec3(velocity);
+			particles.accelerations[global] = vec3(0, 0, 0);
+		}
+	}
+
+	//conjugate gradient iterations of the last step
+	int getLastIterations() {
+		return lastIterations;
+	}
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+
+#include "ParticleStore.h"
+
+// Integration kernels, one policy per scheme. Each kernel predicts the positions of the particles
+// [firstParticle, lastParticle) for one step and stores the positions it started from in oldPositions; the velocity
+// update after the constraints derives the velocities from the corrected positions and clears the accelerations
+// unless the integrator already did. Pinned particles are masked by multiplying with 0, so
+// the loops have no branches. damping is the share of the velocity kept this step, timeStepRatio is the ratio of
+// this step size to the last one. implicitEuler has no kernel here, it needs the springs of the object and is run by
+// the ImplicitEulerSolverT of the solver.
+enum IntegrationScheme { symplecticEuler, velocityVerlet, positionVerlet, implicitEuler };
+
+// v = (x - x_old) / dt, the velocity update of every scheme that takes the velocity from the corrected positions
+template <typename P>
+void updateVelocitiesFromPositions(ParticleStoreT<P> & particles, int firstParticle, int lastParticle, typename P::accumulator timeStepSize) {
+	typedef typename P::vec3 vec3;
+
+	for (int i = firstParticle; i < lastParticle; i++) {
+		if (particles.isMovables[i]) {
+			particles.velocities[i] = vec3((particles.accumulatedPosition(i) - particles.accumulatedOldPosition(i)) / timeStepSize);
+		}
+	}
+}
+
+// v += a dt, x += v dt. Works on the stored velocity, so it needs no history and is the cheapest scheme.
+template <typename P>
+struct SymplecticEulerIntegrator {
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	static void integrate(ParticleStoreT<P> & particles, int firstParticle, int lastParticle,
+		accumulator timeStepSize, accumulator /*timeStepRatio*/, accumulator damping) {
+		std::vector<vec3> & velocities = particles.velocities;
+		std::vector<vec3> & accelerations = particles.accelerations;
+
+		for (int i = firstParticle; i < lastParticle; i++) {
+			accumulator movable = accumulator(particles.isMovables[i]);
+			accumulatorVec3 velocity = movable * (accumulatorVec3(velocities[i]) * damping + accumulatorVec3(accelerations[i]) * timeStepSize);
+			particles.advancePosition(i, particles.accumulatedPosition(i) + velocity * timeStepSize);
+			velocities[i] = vec3(velocity);
+			accelerations[i] = vec3(0, 0, 0);
+		}
+	}
+
+	static void updateVelocities(ParticleStoreT<P> & particles, int firstParticle, int lastParticle, accumulator timeStepSize) {
+		updateVelocitiesFromPositions(particles, firstParticle, lastParticle, timeStepSize);
+	}
+};
+
+// x += v dt + a dt^2 / 2, v += (a + a') dt / 2. The forces are applied once per step, so both half kicks use the
+// same a: the accelerations are kept through the constraints and the velocity update adds the second half kick to
+// the velocity of the corrected positions, which only carries the first one.
+template <typename P>
+struct VelocityVerletIntegrator {
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	static void integrate(ParticleStoreT<P> & particles, int firstParticle, int lastParticle,
+		accumulator timeStepSize, accumulator /*timeStepRatio*/, accumulator damping) {
+		std::vector<vec3> & velocities = particles.velocities;
+		std::vector<vec3> & accelerations = particles.accelerations;
+		accumulator velocityScale = damping * timeStepSize;
+		accumulator accelerationScale = accumulator(0.5) * timeStepSize * timeStepSize;
+
+		for (int i = firstParticle; i < lastParticle; i++) {
+			accumulator movable = accumulator(particles.isMovables[i]);
+			accumulatorVec3 displacement = accumulatorVec3(velocities[i]) * velocityScale + accumulatorVec3(accelerations[i]) * accelerationScale;
+			particles.advancePosition(i, particles.accumulatedPosition(i) + movable * displacement);
+		}
+	}
+
+	static void updateVelocities(ParticleStoreT<P> & particles, int firstParticle, int lastParticle, accumulator timeStepSize) {
+		std::vector<vec3> & velocities = particles.velocities;
+		std::vector<vec3> & accelerations = particles.accelerations;
+		accumulator kickScale = accumulator(0.5) * timeStepSize;
+
+		for (int i = firstParticle; i < lastParticle; i++) {
+			if (particles.isMovables[i]) {
+				accumulatorVec3 velocity = (particles.accumulatedPosition(i) - particles.accumulatedOldPosition(i)) / timeStepSize;
+				velocities[i] = vec3(velocity + accumulatorVec3(accelerations[i]) * kickScale);
+			}
+			accelerations[i] = vec3(0, 0, 0);
+		}
+	}
+};
+
+// x += (x - x_old) * ratio * damping + a dt (dt + dt_last) / 2. Needs no velocities; the displacement of the last
+// step is scaled by the ratio of the step sizes so that a changed step size keeps the velocity, and the acceleration
+// acts over the mean of both steps (time corrected Verlet), which is a dt^2 for a constant step size.
+template <typename P>
+struct PositionVerletIntegrator {
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	static void integrate(ParticleStoreT<P> & particles, int firstParticle, int lastParticle,
+		accumulator timeStepSize, accumulator timeStepRatio, accumulator damping) {
+		std::vector<vec3> & accelerations = particles.accelerations;
+		accumulator displacementScale = timeStepRatio * damping;
+		accumulator accelerationScale = timeStepSize * timeStepSize * (accumulator(1) + accumulator(1) / timeStepRatio) * accumulator(0.5);
+
+		for (int i = firstParticle; i < lastParticle; i++) {
+			accumulator movable = accumulator(particles.isMovables[i]);
+			accumulatorVec3 position = particles.accumulatedPosition(i);
+			accumulatorVec3 displacement = (position - particles.accumulatedOldPosition(i)) * displacementScale + accumulatorVec3(accelerations[i]) * accelerationScale;
+			particles.advancePosition(i, position + movable * displacement);
+			accelerations[i] = vec3(0, 0, 0);
+		}
+	}
+
+	static void updateVelocities(ParticleStoreT<P> & particles, int firstParticle, int lastParticle, accumulator timeStepSize) {
+		updateVelocitiesFromPositions(particles, firstParticle, lastParticle, timeStepSize);
+	}
+};
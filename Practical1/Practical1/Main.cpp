@@ -8,27 +8,49 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <chrono>
-#include <thread>
 
 #include "ShaderUtility.h"
+#include "FramePacer.h"
+#include "QualityGovernor.h"
 
-//#define DOUBLE_PRECISION			//Uncomment this line to switch to double precision
+//#define DOUBLE_PRECISION			//Uncomment this line to switch the game world to double precision
+//#define COMPACT_CONSTRAINT_INDICES	//Uncomment this line to store constraint indices inside objects in 16 bit
+//#define MIXED_PRECISION			//Uncomment this line to store the game world in float but integrate and project in double
+//#define PERF_COUNTERS				//Uncomment this line to read hardware performance counters per solver phase (Linux only)
 
 #include "ParticleNetworkRenderer.h"
 #include "Particle.h"
+#include "ParticleStore.h"
+#include "World.h"
 #include "PlaneRenderer.h"
 #include "Collider.h"
 
 #include "PlaneCollider.h"
 #include "AABBRenderer.h"
 #include "AABBCollider.h"
+#include "SDFCollider.h"
+#include "TriangleMeshCollider.h"
 
 #include "RopeManager.h"
 #include "Character.h"
+#include "PrecisionBenchmark.h"
+#include "PipelineBenchmark.h"
+#include "FloatingOrigin.h"
+#include "AdaptiveSubstepper.h"
 
 const SCALAR INITIAL_TIME_STEP_SIZE = 0.008;
-const SCALAR DRAG_CONSTANT = 0.0;
+const SCALAR DRAG_CONSTANT = 0.05; // share of the velocity every object loses per second
+const SCALAR CHARACTER_DRAG_CONSTANT = 0.0;
+const SCALAR ROPE_DRAG_CONSTANT = 0.3;
+//the body is driven by forces every frame and needs no position history, the ropes keep their swing best with Verlet
+const IntegrationScheme CHARACTER_INTEGRATION_SCHEME = symplecticEuler;
+const IntegrationScheme ROPE_INTEGRATION_SCHEME = positionVerlet;
+//stiff ropes integrated implicitly as springs are stable with a single step per frame
+const bool IMPLICIT_ROPES = false;
+const SCALAR ROPE_SPRING_STIFFNESS = 2000;
+const SCALAR ROPE_SPRING_DAMPING = 2;
 const int CONSTRAINT_ITERATIONS = 2;
+const SCALAR CONSTRAINT_TOLERANCE = 0.0005;
 
 const float CHAR_SIZE = 0.12f;
 const float CHAR_ARM_LENGTH = 3.5f;
@@ -37,8 +59,40 @@ const float ROPE_SIZE = 0.25f;
 const float GRAVITY = -4.f;
 const float INPUT_POWER = 4.0f;
 const int SIMULATION_ITERATIONS_PER_FRAME = 3;
+const int MIN_SIMULATION_ITERATIONS_PER_FRAME = 1;
+const int MAX_SIMULATION_ITERATIONS_PER_FRAME = 6;
+const SCALAR MAX_SUBSTEP_DISPLACEMENT = 0.5; // share of the smallest constraint or collider a particle may move per substep
+const int MIN_CONSTRAINT_ITERATIONS = 1;
+const int MAX_CONSTRAINT_ITERATIONS = 8;
+const double SOLVER_FRAME_BUDGET = 0.004;
+const SCALAR FLOATING_ORIGIN_REBASE_DISTANCE = 8;
+const int BENCHMARK_PARTICLES = 1000;
+const int BENCHMARK_STEPS = 2000;
 const float CONNECTION_THRESHOLD = .1f;
-
+const bool DIRECT_ROPE_SOLVE = true;
+const bool UNROLLED_CHARACTER_SOLVE = true;
+const bool CHARACTER_SHAPE_MATCHING = true;
+const bool CHARACTER_PROJECTIVE_DYNAMICS = false;
+const bool ROPE_PROJECTIVE_DYNAMICS = false;
+const SCALAR PROJECTIVE_DYNAMICS_WEIGHT = 1.0e5;
+const bool ROPE_LONG_RANGE_ATTACHMENTS = true;
+const bool PARTICLE_COLLISIONS = true;
+const bool ROPE_SEGMENT_COLLISIONS = true;
+const SCALAR VERLET_SKIN = 0.1; // collision candidates are searched again once a particle moved half of it
+const SCALAR ROPE_PARTICLE_RADIUS = 0.06;
+const SCALAR CHARACTER_PARTICLE_RADIUS = 0.06;
+const bool SDF_LEVEL = false; // bake the obstacles into a distance grid instead of testing every box
+const SCALAR LEVEL_SDF_CELL_SIZE = 0.05;
+const std::string LEVEL_SDF_FILE = "level.sdf"; // baked once and mapped on later starts, delete it after changing the obstacles
+const std::string LEVEL_MESH_FILE = ""; // OBJ file of additional level geometry, none if empty
+const bool CHEBYSHEV_ACCELERATION = false;
+const SCALAR CHEBYSHEV_SPECTRAL_RADIUS = 0.9; // initial estimate, refined if there are two or more warm-up iterations
+const int CHEBYSHEV_WARM_UP_ITERATIONS = 1; // plain passes before extrapolating, needs to stay below CONSTRAINT_ITERATIONS
+const int PERF_COUNTER_REPORT_INTERVAL = 120;
+const double TARGET_FRAME_PERIOD = 1.0 / 60.0;
+const double FRAME_PACER_SPIN_THRESHOLD = 0.002;
+
+World * world;
 Character * character;
 Rope * rope;
 RopeManager * ropeMgr;
@@ -47,12 +101,31 @@ PlaneCollider * rightPlaneCollider;
 PlaneCollider * bottomPlaneCollider;
 AABBCollider * destinationBox;
 AABBCollider * obstacleBox;
-
-IntegrationScheme currentIntegrationScheme = verlet;
+SDFCollider * levelField = nullptr;
+TriangleMeshCollider * levelMesh = nullptr;
+PhaseProfiler * profiler;
+FramePacer * framePacer;
+QualityGovernor * governor;
+FloatingOrigin * floatingOrigin;
+AdaptiveSubstepper * substepper;
+PipelineBenchmark * pipelineBenchmark;
+ProximityTracker * grabTracker;
+std::vector<Collider *> colliders;
 
 bool renderParticlesAndConstraints = false;
 bool printElapsedTime = false;
+bool printPerfCounters = false;
+bool printResiduals = false;
 bool dragEnabled = true;
+bool directRopeSolve = DIRECT_ROPE_SOLVE;
+bool ropeLongRangeAttachments = ROPE_LONG_RANGE_ATTACHMENTS;
+bool particleCollisions = PARTICLE_COLLISIONS;
+bool ropeSegmentCollisions = ROPE_SEGMENT_COLLISIONS;
+bool chebyshevAcceleration = CHEBYSHEV_ACCELERATION;
+bool implicitRopes = IMPLICIT_ROPES;
+bool characterShapeMatching = CHARACTER_SHAPE_MATCHING;
+bool characterProjectiveDynamics = CHARACTER_PROJECTIVE_DYNAMICS;
+bool ropeProjectiveDynamics = ROPE_PROJECTIVE_DYNAMICS;
 bool isPlayerGravityEnabled = false;
 bool areArmsSticky = true;
 float timer = 0.0f;
@@ -60,6 +133,7 @@ float viewingAngle = 25.0f;
 
 void startGame() {
 	isPlayerGravityEnabled = true;
+	character->setSimulated(true);
 }
 
 void moveRight() {
@@ -70,6 +144,49 @@ void moveLeft() {
 	character->addForce(vec3(-INPUT_POWER, 0, 0));
 }
 
+void setChebyshevAcceleration(bool enabled) {
+	character->solver->setChebyshevAcceleration(enabled, CHEBYSHEV_SPECTRAL_RADIUS, CHEBYSHEV_WARM_UP_ITERATIONS);
+	ropeMgr->setChebyshevAcceleration(enabled, CHEBYSHEV_SPECTRAL_RADIUS, CHEBYSHEV_WARM_UP_ITERATIONS);
+}
+
+void setCharacterSolveMode() {
+	if (characterProjectiveDynamics)
+		character->solver->setConstraintSolveMode(projectiveDynamics);
+	else
+		character->solver->setConstraintSolveMode(UNROLLED_CHARACTER_SOLVE ? unrolledTopology : iterativeConstraints);
+}
+
+void setRopeSolveMode() {
+	if (ropeProjectiveDynamics)
+		ropeMgr->setConstraintSolveMode(projectiveDynamics);
+	else
+		ropeMgr->setConstraintSolveMode(directRopeSolve ? directChain : iterativeConstraints);
+}
+
+//Applies the settings the keys switch to the objects once at startup, the key handlers only change their own one
+void applySimulationSettings() {
+	ropeMgr->setProjectiveDynamicsWeight(PROJECTIVE_DYNAMICS_WEIGHT);
+	setRopeSolveMode();
+	ropeMgr->setLongRangeAttachments(ropeLongRangeAttachments);
+	ropeMgr->setParticleRadius(ROPE_PARTICLE_RADIUS);
+	character->setParticleRadius(CHARACTER_PARTICLE_RADIUS);
+	world->setParticleCollisions(particleCollisions);
+	world->setSegmentCollisions(ropeSegmentCollisions);
+	setChebyshevAcceleration(chebyshevAcceleration);
+	ropeMgr->setSpringStiffness(ROPE_SPRING_STIFFNESS, ROPE_SPRING_DAMPING);
+	if (implicitRopes)
+		ropeMgr->setIntegrationScheme(implicitEuler);
+}
+
+//moves everything by -shift so that the player is back at the origin
+void rebaseWorld(const vec3 & shift) {
+	character->shiftOrigin(shift);
+	ropeMgr->shiftOrigin(shift);
+	for (Collider * collider : colliders) {
+		collider->shiftOrigin(shift);
+	}
+}
+
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
 	if (action == GLFW_PRESS) {
 		switch (key) {
@@ -77,6 +194,72 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 			printElapsedTime = !printElapsedTime;
 			std::cout << "Switched printing of elapsed time" << std::endl;
 			break;
+		case GLFW_KEY_C:
+			printPerfCounters = !printPerfCounters;
+			if (!profiler->isAvailable())
+				std::cout << "Performance counters are not available in this build" << std::endl;
+			else
+				std::cout << "Switched printing of performance counters" << std::endl;
+			profiler->reset();
+			break;
+		case GLFW_KEY_R:
+			printResiduals = !printResiduals;
+			std::cout << "Switched printing of constraint residuals" << std::endl;
+			break;
+		case GLFW_KEY_V:
+			framePacer->setMode(framePacer->getMode() == vsyncPacing ? sleepAndSpin : vsyncPacing);
+			glfwSwapInterval(framePacer->getMode() == vsyncPacing ? 1 : 0);
+			std::cout << "Frame pacing: " << (framePacer->getMode() == vsyncPacing ? "vsync" : "sleep and spin") << std::endl;
+			break;
+		case GLFW_KEY_B:
+			PrecisionBenchmark(BENCHMARK_PARTICLES, BENCHMARK_STEPS, CONSTRAINT_ITERATIONS, INITIAL_TIME_STEP_SIZE, ROPE_SIZE, GRAVITY).run();
+			pipelineBenchmark->run();
+			break;
+		case GLFW_KEY_T:
+			directRopeSolve = !directRopeSolve;
+			setRopeSolveMode();
+			std::cout << "Rope constraints: " << (directRopeSolve ? "direct chain solve" : "iterative") << std::endl;
+			break;
+		case GLFW_KEY_L:
+			ropeLongRangeAttachments = !ropeLongRangeAttachments;
+			ropeMgr->setLongRangeAttachments(ropeLongRangeAttachments);
+			std::cout << "Rope long range attachments " << (ropeLongRangeAttachments ? "on" : "off") << std::endl;
+			break;
+		case GLFW_KEY_I:
+			implicitRopes = !implicitRopes;
+			ropeMgr->setIntegrationScheme(implicitRopes ? implicitEuler : ROPE_INTEGRATION_SCHEME);
+			std::cout << "Rope integration: " << (implicitRopes ? "implicit springs, one step per frame" : "position based") << std::endl;
+			break;
+		case GLFW_KEY_N:
+			particleCollisions = !particleCollisions;
+			world->setParticleCollisions(particleCollisions);
+			std::cout << "Collisions between particles " << (particleCollisions ? "on" : "off") << std::endl;
+			break;
+		case GLFW_KEY_G:
+			ropeSegmentCollisions = !ropeSegmentCollisions;
+			world->setSegmentCollisions(ropeSegmentCollisions);
+			std::cout << "Collisions between rope segments " << (ropeSegmentCollisions ? "on" : "off") << std::endl;
+			break;
+		case GLFW_KEY_K:
+			chebyshevAcceleration = !chebyshevAcceleration;
+			setChebyshevAcceleration(chebyshevAcceleration);
+			std::cout << "Chebyshev acceleration " << (chebyshevAcceleration ? "on" : "off") << std::endl;
+			break;
+		case GLFW_KEY_M:
+			characterShapeMatching = !characterShapeMatching;
+			character->setShapeMatching(characterShapeMatching);
+			std::cout << "Character body: " << (characterShapeMatching ? "shape matching" : "distance constraints") << std::endl;
+			break;
+		case GLFW_KEY_J:
+			characterProjectiveDynamics = !characterProjectiveDynamics;
+			setCharacterSolveMode();
+			std::cout << "Character constraints: " << (characterProjectiveDynamics ? "projective dynamics" : "position based") << std::endl;
+			break;
+		case GLFW_KEY_H:
+			ropeProjectiveDynamics = !ropeProjectiveDynamics;
+			setRopeSolveMode();
+			std::cout << "Rope constraints: " << (ropeProjectiveDynamics ? "projective dynamics" : "position based") << std::endl;
+			break;
 		case GLFW_KEY_O:
 			dragEnabled = !dragEnabled;
 			std::cout << (std::string("Turned drag ") + (dragEnabled ? "on" : "off")).c_str() << std::endl;
@@ -163,11 +346,8 @@ int main(void) {
 	glm::mat4 normalTransformationMatrix;
 
 	const SCALAR timeStepSize = INITIAL_TIME_STEP_SIZE;
-	const SCALAR dragConstant = DRAG_CONSTANT;
 	const int constraintIterations = CONSTRAINT_ITERATIONS;
 
-	std::vector<Collider *> colliders;
-
 	leftPlaneCollider = new PlaneCollider(vec3(-11.25, 0, 0), vec3(1, 0, 0), shaderProgramId);
 	leftPlaneCollider->setActive(true);
 	colliders.push_back(leftPlaneCollider);
@@ -186,14 +366,66 @@ int main(void) {
 
 	obstacleBox = new AABBCollider(vec3(-8.55f, .5f, 0), 0.4f, 1, shaderProgramId);
 	obstacleBox->setActive(true);
-	colliders.push_back(obstacleBox);
 
-	character = new Character(currentIntegrationScheme, shaderProgramId, CHAR_SIZE, CHAR_ARM_LENGTH, vec3(3,4,0));
+	if (SDF_LEVEL) {
+		std::vector<Collider *> obstacles = { obstacleBox };
+		vec3 margin = vec3(0.5, 0.5, 0);
+		vec3 obstacleSize = vec3(0.4, 1, 0);
+		DistanceGrid * grid = nullptr;
+		if (std::ifstream(LEVEL_SDF_FILE).good())
+			grid = DistanceGrid::map(LEVEL_SDF_FILE);
+		if (grid == nullptr) {
+			grid = DistanceGrid::bake(obstacles, obstacleBox->getPosition() - obstacleSize / SCALAR(2) - margin,
+				obstacleBox->getPosition() + obstacleSize / SCALAR(2) + margin, LEVEL_SDF_CELL_SIZE);
+			grid->save(LEVEL_SDF_FILE);
+		}
+		levelField = new SDFCollider(grid, shaderProgramId);
+		levelField->setActive(true);
+		colliders.push_back(levelField);
+	}
+	else
+		colliders.push_back(obstacleBox);
+
+	if (!LEVEL_MESH_FILE.empty()) {
+		levelMesh = TriangleMeshCollider::loadOBJ(LEVEL_MESH_FILE, shaderProgramId);
+		if (levelMesh != nullptr) {
+			levelMesh->setActive(true);
+			colliders.push_back(levelMesh);
+		}
+	}
+
+	profiler = new PhaseProfiler();
+
+	world = new World(constraintIterations);
+	world->setProfiler(profiler);
+	world->setConstraintTolerance(CONSTRAINT_TOLERANCE);
+	world->setDragConstant(DRAG_CONSTANT);
+	world->setVerletSkin(VERLET_SKIN);
+
+	character = new Character(CHARACTER_INTEGRATION_SCHEME, world->getParticles(), shaderProgramId, CHAR_SIZE, CHAR_ARM_LENGTH, vec3(3,4,0));
+	character->setSimulated(false);
 	character->solver->setConstraintIterations(constraintIterations);
-	character->solver->setDragConstant(dragConstant);
+	character->solver->setDragConstant(CHARACTER_DRAG_CONSTANT);
 	character->solver->setColliders(colliders);
-
-	ropeMgr = new RopeManager( shaderProgramId, constraintIterations, dragConstant, ROPE_SIZE, vec3(0,4.f,0));
+	character->setShapeMatching(characterShapeMatching);
+	character->solver->setProjectiveDynamicsWeight(PROJECTIVE_DYNAMICS_WEIGHT);
+	setCharacterSolveMode();
+	world->addObject(character);
+
+	ropeMgr = new RopeManager(ROPE_INTEGRATION_SCHEME, world->getParticles(), shaderProgramId, constraintIterations, ROPE_DRAG_CONSTANT, ROPE_SIZE, vec3(0,4.f,0));
+	ropeMgr->addToWorld(world);
+	applySimulationSettings();
+
+	grabTracker = new ProximityTracker(CONNECTION_THRESHOLD);
+	grabTracker->setParticles(character->getHands(), ropeMgr->getParticles(), world->getParticles().positions);
+
+	floatingOrigin = new FloatingOrigin(FLOATING_ORIGIN_REBASE_DISTANCE);
+	substepper = new AdaptiveSubstepper(MAX_SUBSTEP_DISPLACEMENT);
+	pipelineBenchmark = new PipelineBenchmark(BENCHMARK_PARTICLES, BENCHMARK_STEPS, CONSTRAINT_ITERATIONS, INITIAL_TIME_STEP_SIZE, ROPE_SIZE, GRAVITY, shaderProgramId);
+	governor = new QualityGovernor(SOLVER_FRAME_BUDGET,
+		SIMULATION_ITERATIONS_PER_FRAME, MIN_SIMULATION_ITERATIONS_PER_FRAME, MAX_SIMULATION_ITERATIONS_PER_FRAME,
+		CONSTRAINT_ITERATIONS, MIN_CONSTRAINT_ITERATIONS, MAX_CONSTRAINT_ITERATIONS);
+	framePacer = new FramePacer(TARGET_FRAME_PERIOD, FRAME_PACER_SPIN_THRESHOLD);
 
 	std::cout << "Press ENTER to start the game." << std::endl;
 	std::cout << "Press SPACE to make arms sticky/unsticky." << std::endl;
@@ -205,22 +437,40 @@ int main(void) {
 		auto startTime = std::chrono::high_resolution_clock::now();
 		timer++;
 
-		// enable connectors
+		// enable connectors, the tracker tells the character when rope particles come within reach of a hand
+		grabTracker->update(world->getParticles().positions);
+		for (const ProximityEvent & event : grabTracker->getEvents())
+			character->handleProximityEvent(event);
 		if (areArmsSticky)
-			character->tryConnectorConstraint(ropeMgr, CONNECTION_THRESHOLD);
+			character->tryConnectorConstraint();
+
+		//the simulated time per frame stays the same, fewer substeps just take larger steps. The motion decides how
+		//many substeps are needed, the governor caps them to the frame budget.
+		auto solverStartTime = std::chrono::high_resolution_clock::now();
+		SCALAR frameTime = timeStepSize * SIMULATION_ITERATIONS_PER_FRAME;
+		int substeps = implicitRopes ? 1 : substepper->chooseSubsteps(world->getMaxSpeed(), world->getSmallestFeatureSize(), frameTime, governor->getSubsteps());
+		SCALAR substepSize = frameTime / substeps;
 
-		for (int i = 0; i < SIMULATION_ITERATIONS_PER_FRAME; i++) {
+		for (int i = 0; i < substeps; i++) {
 			//advance the simulation one time step (in a more efficient implementation this should be done in a separate thread to decouple rendering frame rate from simulation rate):
-			if (isPlayerGravityEnabled) {
+			if (isPlayerGravityEnabled)
 				character->addForce(vec3(0, GRAVITY, 0));
-				character->timeStep(timeStepSize, dragEnabled);
-			}
-			ropeMgr->timeStep(GRAVITY, timeStepSize);
+			ropeMgr->addForce(vec3(0, GRAVITY, 0));
+			world->step(substepSize, dragEnabled);
+		}
+
+		std::chrono::duration<double> solverTime = std::chrono::high_resolution_clock::now() - solverStartTime;
+		if (governor->reportSolverTime(solverTime.count())) {
+			world->setConstraintIterations(governor->getConstraintIterations());
 		}
 		// delete all connectors if arms are not sticky
 		if(!areArmsSticky)
 			character->removeConnectorConstraints();
 
+		vec3 originShift;
+		if (floatingOrigin->update(character->getCenter(), originShift))
+			rebaseWorld(originShift);
+
 		//render:
 		glfwGetFramebufferSize(window, &width, &height);
 		float ratio = width / static_cast<float>(height);
@@ -237,8 +487,8 @@ int main(void) {
 		}
 
 		//set up 2D rendering
-		//all objects are drawn with the same model view projection matrix
-		modelViewMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, 0, -5));
+		//all objects are drawn with the same model view projection matrix, the camera stays fixed in absolute coordinates
+		modelViewMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(4.0f, 0, -5) + glm::vec3(floatingOrigin->getOrigin()));
 		normalTransformationMatrix = glm::inverse(glm::transpose(modelViewMatrix));
 
 		modelViewProjectionMatrix = perspectiveProjection * modelViewMatrix;
@@ -256,7 +506,12 @@ int main(void) {
 		bottomPlaneCollider->renderer->draw();
 
 		destinationBox->renderer->draw();
-		obstacleBox->renderer->draw();
+		if (levelField != nullptr)
+			levelField->renderer->draw();
+		else
+			obstacleBox->renderer->draw();
+		if (levelMesh != nullptr)
+			levelMesh->renderer->draw();
 
 		//Swap front and back buffers 
 		glfwSwapBuffers(window);
@@ -266,17 +521,33 @@ int main(void) {
 
 		auto endTime = std::chrono::high_resolution_clock::now();
 
-		std::chrono::duration<float> fs = endTime - startTime;
-		std::chrono::milliseconds d = std::chrono::duration_cast<std::chrono::milliseconds>(fs);
+		std::chrono::duration<float, std::milli> d = endTime - startTime;
 		
 		if (printElapsedTime)
 			std::cout << d.count() << std::endl;
 
-		std::this_thread::sleep_for(std::chrono::milliseconds(16) - d);
+		if (printPerfCounters && (int)timer % PERF_COUNTER_REPORT_INTERVAL == 0)
+			profiler->print();
+
+		if (printResiduals && (int)timer % PERF_COUNTER_REPORT_INTERVAL == 0)
+			world->printResiduals();
+
+		if (!framePacer->waitForNextFrame() && printElapsedTime)
+			std::cout << "Missed frame deadline by " << framePacer->getLastOverrun() * 1000.0 << " ms (" << framePacer->getMissedDeadlines() << " total)" << std::endl;
 	}
 
 	delete character;
 	ropeMgr->deleteRopes();
+	delete profiler;
+	delete framePacer;
+	delete governor;
+	delete floatingOrigin;
+	delete substepper;
+	delete grabTracker;
+	delete levelField;
+	delete levelMesh;
+	delete pipelineBenchmark;
+	delete world;
 
 	glfwTerminate();
 	return 0;
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Renderer.h"
+
+class MeshRenderer : public Renderer {
+private:
+	std::vector<vec3> positions;
+
+public:
+	//draws a triangle mesh given as three corners per triangle, flat shaded
+	MeshRenderer(GLhandleARB shaderProgramId, const std::vector<vec3> & corners) : Renderer(shaderProgramId) {
+		positions = corners;
+		numberOfVertices = positions.size();
+
+		for (int i = 0; i + 2 < numberOfVertices; i += 3) {
+			vec3 normal = glm::cross(positions[i + 1] - positions[i], positions[i + 2] - positions[i]);
+			if (glm::length(normal) > 0)
+				normal = glm::normalize(normal);
+			for (int j = 0; j < 3; j++) {
+				normals.push_back(normal);
+			}
+		}
+	}
+
+	void setupOpenGLBuffers() {
+		glGenBuffers(1, &vertexPosBufferHandle);
+		glGenBuffers(1, &vertexNormalBufferHandle);
+
+		vertexPosAttribLocation = glGetAttribLocation(shaderProgramId, "vertexPos");
+		vertexNormalAttribLocation = glGetAttribLocation(shaderProgramId, "vertexNormal");
+		colorLocation = glGetUniformLocation(shaderProgramId, "color");
+	}
+
+	void draw() {
+		if (numberOfVertices == 0)
+			return;
+		glEnableVertexAttribArray(vertexPosAttribLocation);
+		glEnableVertexAttribArray(vertexNormalAttribLocation);
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexPosBufferHandle);
+		glVertexAttribPointer(vertexPosAttribLocation, 3, GL_SCALAR, GL_FALSE, 0, NULL);
+		glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(vec3), &(positions[0]), GL_DYNAMIC_DRAW);
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexNormalBufferHandle);
+		glVertexAttribPointer(vertexNormalAttribLocation, 3, GL_SCALAR, GL_FALSE, 0, NULL);
+		glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(vec3), &(normals[0]), GL_DYNAMIC_DRAW);
+
+		glUniform4f(colorLocation, 0.4f, 0.7f, 0.4f, 1);
+		glDrawArrays(GL_TRIANGLES, 0, numberOfVertices);
+		glDisableVertexAttribArray(vertexNormalAttribLocation);
+	}
+
+	void shiftOrigin(const vec3 & shift) {
+		for (vec3 & position : positions) {
+			position -= shift;
+		}
+	}
+};
@@ -1,5 +1,3 @@
 struct Particle {
-	int id;
-	std::vector<vec3> * positions;
-	std::vector<bool> * isMovables;
-};
+	int id; // global index into the ParticleStore
+};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.h"
+#include "VerletList.h"
+
+// Collisions between particles of different objects, e.g. of two ropes or of a rope and the character. Every
+// particle is a sphere with its radius from the store, particles with radius 0 and particles of the same group are
+// left out. The particles are sorted into a spatial hash with cells of the largest diameter, built by counting
+// sort, so a particle only has to look at the 27 cells around it and the cost stays linear in the number of
+// particles. The contacts are resolved like the constraints: every overlapping pair is pushed apart along its
+// normal, weighted with the inverse masses. Each particle only gathers its own correction, averaged over its
+// contacts, so the search and the resolution run in parallel over the particles.
+// The search collects every pair closer than the sum of the radii plus a skin into a Verlet list, which is reused
+// until a particle moved more than half the skin. With a skin of 0 the search runs every step.
+template <typename P>
+class ParticleCollisionT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	std::vector<int> activeParticles; // global indices of the particles taking part this step
+	std::vector<unsigned int> buckets; // hash bucket of every active particle
+	std::vector<int> bucketStart; // the sorted particles of bucket b are [bucketStart[b], bucketStart[b + 1])
+
+	//what a query reads of another particle, packed together
+	struct Sphere {
+		accumulatorVec3 position;
+		accumulator radius;
+		accumulator inverseMass;
+		int group;
+		glm::ivec3 cell;
+	};
+
+	//the active particles sorted by bucket, so the particles of a bucket are read from one place
+	std::vector<int> sortedParticles;
+	std::vector<Sphere> spheres;
+	std::vector<accumulatorVec3> corrections;
+	std::vector<std::vector<int> > neighbours; // candidates of every sorted particle, indices into spheres
+
+	VerletListT<P> verletList = VerletListT<P>(0);
+	unsigned int bucketMask = 0;
+	scalar maxRadius = 0;
+	scalar builtMaxRadius = 0;
+	scalar cellSize = 0;
+	int numberOfContacts = 0;
+
+	inline glm::ivec3 cell(const accumulatorVec3 & position) {
+		return glm::ivec3(glm::floor(position / accumulator(cellSize)));
+	}
+
+	//Cells next to each other in x get consecutive buckets, so a query reads each row of 3 cells as one range
+	inline unsigned int hash(const glm::ivec3 & c) {
+		return ((unsigned int)c.x + (unsigned int)c.y * 19349663u + (unsigned int)c.z * 83492791u) & bucketMask;
+	}
+
+	//Collects the candidates of sphere k among the particles of the row of cells x - 1 to x + 1 in the buckets [first, last)
+	inline void searchRow(int k, const glm::ivec3 & row, int first, int last) {
+		const Sphere & sphere = spheres[k];
+		accumulator skin = verletList.getSkin();
+		for (int j = first; j < last; j++) {
+			const Sphere & other = spheres[j];
+			//distinct cells can share a bucket, so only the particles of the row itself are taken
+			if (other.group == sphere.group || other.cell.y != row.y || other.cell.z != row.z || glm::abs(other.cell.x - row.x) > 1)
+				continue;
+			accumulatorVec3 vec = sphere.position - other.position;
+			accumulator reach = sphere.radius + other.radius + skin;
+			if (glm::dot(vec, vec) < reach * reach)
+				neighbours[k].push_back(j);
+		}
+	}
+
+	void search() {
+		int n = (int)spheres.size();
+		neighbours.resize(n);
+		#pragma omp parallel for if (n > 1024)
+		for (int k = 0; k < n; k++) {
+			neighbours[k].clear();
+			for (int dy = -1; dy <= 1; dy++) for (int dz = -1; dz <= 1; dz++) {
+				glm::ivec3 row = spheres[k].cell + glm::ivec3(0, dy, dz);
+				unsigned int b = hash(row - glm::ivec3(1, 0, 0));
+				if (b + 2 <= bucketMask)
+					searchRow(k, row, bucketStart[b], bucketStart[b + 3]);
+				else for (int dx = -1; dx <= 1; dx++) {
+					//the row wraps around the end of the table
+					unsigned int cellBucket = hash(row + glm::ivec3(dx, 0, 0));
+					searchRow(k, row, bucketStart[cellBucket], bucketStart[cellBucket + 1]);
+				}
+			}
+		}
+	}
+
+	void buildHash(ParticleStoreT<P> & particles) {
+		int n = (int)activeParticles.size();
+		cellSize = 2 * maxRadius + verletList.getSkin();
+		unsigned int numberOfBuckets = 1;
+		while (numberOfBuckets < 2 * (unsigned int)n)
+			numberOfBuckets *= 2;
+		bucketMask = numberOfBuckets - 1;
+
+		buckets.resize(n);
+		bucketStart.assign(numberOfBuckets + 1, 0);
+		for (int k = 0; k < n; k++) {
+			buckets[k] = hash(cell(accumulatorVec3(particles.positions[activeParticles[k]])));
+			bucketStart[buckets[k] + 1]++;
+		}
+		for (unsigned int b = 0; b < numberOfBuckets; b++)
+			bucketStart[b + 1] += bucketStart[b];
+
+		std::vector<int> fill(bucketStart.begin(), bucketStart.end() - 1);
+		sortedParticles.resize(n);
+		spheres.resize(n);
+		for (int k = 0; k < n; k++) {
+			int i = activeParticles[k];
+			int s = fill[buckets[k]]++;
+			sortedParticles[s] = i;
+			spheres[s].position = accumulatorVec3(particles.positions[i]);
+			spheres[s].radius = particles.radii[i];
+			spheres[s].inverseMass = particles.isMovables[i] ? accumulator(1) / particles.masses[i] : accumulator(0);
+			spheres[s].group = particles.groups[i];
+			spheres[s].cell = cell(spheres[s].position);
+		}
+	}
+
+	//Whether a particle of the list got another radius since it was built, its candidates were searched with the old one
+	bool radiiChanged(ParticleStoreT<P> & particles) {
+		for (int k = 0; k < (int)sortedParticles.size(); k++) {
+			if (spheres[k].radius != particles.radii[sortedParticles[k]])
+				return true;
+		}
+		return false;
+	}
+
+public:
+	//Starts collecting the particles of this step
+	void clear() {
+		activeParticles.clear();
+		maxRadius = 0;
+	}
+
+	//Adds the particles [firstParticle, firstParticle + numberOfParticles) that have a radius
+	void addParticles(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles) {
+		for (int i = firstParticle; i < firstParticle + numberOfParticles; i++) {
+			if (particles.radii[i] > 0) {
+				activeParticles.push_back(i);
+				maxRadius = glm::max(maxRadius, particles.radii[i]);
+			}
+		}
+	}
+
+	//Pushes all overlapping particles of the collected ones apart:
+	void solve(ParticleStoreT<P> & particles) {
+		int n = (int)activeParticles.size();
+		numberOfContacts = 0;
+		if (n < 2)
+			return;
+		if (maxRadius != builtMaxRadius || radiiChanged(particles))
+			verletList.invalidate();
+		if (verletList.needsRebuild(particles.positions, activeParticles)) {
+			buildHash(particles);
+			search();
+			builtMaxRadius = maxRadius;
+		}
+		else {
+			for (int k = 0; k < n; k++) {
+				int i = sortedParticles[k];
+				spheres[k].position = accumulatorVec3(particles.positions[i]);
+				spheres[k].inverseMass = particles.isMovables[i] ? accumulator(1) / particles.masses[i] : accumulator(0);
+			}
+		}
+		corrections.resize(n);
+
+		int contacts = 0;
+		#pragma omp parallel for reduction(+:contacts) if (n > 1024)
+		for (int k = 0; k < n; k++) {
+			const Sphere & sphere = spheres[k];
+			accumulatorVec3 correction = accumulatorVec3(0, 0, 0);
+			int particleContacts = 0;
+			for (int j : neighbours[k]) {
+				const Sphere & other = spheres[j];
+				accumulatorVec3 vec = sphere.position - other.position;
+				accumulator radiusSum = sphere.radius + other.radius;
+				accumulator squaredDistance = glm::dot(vec, vec);
+				if (squaredDistance >= radiusSum * radiusSum || squaredDistance == accumulator(0))
+					continue;
+				accumulator inverseMassSum = sphere.inverseMass + other.inverseMass;
+				if (inverseMassSum == accumulator(0))
+					continue;
+				accumulator distance = glm::sqrt(squaredDistance);
+				correction += sphere.inverseMass / inverseMassSum * (radiusSum - distance) / distance * vec;
+				particleContacts++;
+			}
+			corrections[k] = particleContacts > 0 ? correction / accumulator(particleContacts) : correction;
+			contacts += particleContacts;
+		}
+
+		for (int k = 0; k < n; k++)
+			particles.positions[sortedParticles[k]] = vec3(spheres[k].position + corrections[k]);
+		numberOfContacts = contacts / 2;
+	}
+
+	void setSkin(scalar skin) {
+		verletList.setSkin(skin);
+	}
+
+	VerletListT<P> & getVerletList() {
+		return verletList;
+	}
+
+	//overlapping pairs found in the last step
+	int getNumberOfContacts() {
+		return numberOfContacts;
+	}
+};
+
+typedef ParticleCollisionT<WorldPrecision> ParticleCollision;
@@ -7,14 +7,16 @@ class ParticleNetworkRenderer : public Renderer {
 private:
 	std::vector<Constraint> & constraints; // constraints between the particles
 	std::vector<vec3> & positions;
+	int firstVertex; // the particles drawn are [firstVertex, firstVertex + numberOfVertices) of positions
 
 	GLuint linesIndexBufferHandle;
 
 public:
-	ParticleNetworkRenderer(GLhandleARB shaderProgramId, std::vector<vec3> & positions,
+	ParticleNetworkRenderer(GLhandleARB shaderProgramId, std::vector<vec3> & positions, int firstVertex,
 		std::vector<Constraint> & constraints, const int numberOfVertices) :
 		Renderer(shaderProgramId), constraints(constraints), positions(positions) {
 
+		this->firstVertex = firstVertex;
 		this->numberOfVertices = numberOfVertices;
 	}
 
@@ -29,7 +31,7 @@ public:
 		colorLocation = glGetUniformLocation(shaderProgramId, "color");
 
 		std::vector<unsigned int> constraintsVec;
-		for (Constraint constraint : constraints) {
+		for (Constraint & constraint : constraints) {
 			constraintsVec.push_back(constraint.getP1());
 			constraintsVec.push_back(constraint.getP2());
 		}
@@ -45,7 +47,7 @@ public:
 
 		glBindBuffer(GL_ARRAY_BUFFER, vertexPosBufferHandle);
 		glVertexAttribPointer(vertexPosAttribLocation, 3, GL_SCALAR, GL_FALSE, 0, NULL);
-		glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(vec3), &(positions[0]), GL_DYNAMIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, numberOfVertices * sizeof(vec3), &(positions[firstVertex]), GL_DYNAMIC_DRAW);
 
 		glBindBuffer(GL_ARRAY_BUFFER, vertexNormalBufferHandle);
 		glVertexAttribPointer(vertexNormalAttribLocation, 3, GL_SCALAR, GL_FALSE, 0, NULL);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <type_traits>
+
+#include "Precision.h"
+
+// Positions as the integration accumulated them, so they do not lose what rounding to storage cuts off. Only an
+// Accumulator wider than Storage needs this second copy, the specialization below keeps none and works on the
+// stored positions directly.
+template <typename P, bool widened = !std::is_same<typename P::scalar, typename P::accumulator>::value>
+class AccumulatedPositionsT {
+private:
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	std::vector<accumulatorVec3> positions;
+	std::vector<accumulatorVec3> oldPositions;
+
+public:
+	void resize(int count) {
+		positions.resize(count, accumulatorVec3(0, 0, 0));
+		oldPositions.resize(count, accumulatorVec3(0, 0, 0));
+	}
+
+	//If another pass moved the particle since the integration, the stored position is taken instead
+	inline accumulatorVec3 position(const std::vector<vec3> & storedPositions, int i) {
+		return vec3(positions[i]) == storedPositions[i] ? positions[i] : accumulatorVec3(storedPositions[i]);
+	}
+
+	inline accumulatorVec3 oldPosition(const std::vector<vec3> & storedOldPositions, int i) {
+		return vec3(oldPositions[i]) == storedOldPositions[i] ? oldPositions[i] : accumulatorVec3(storedOldPositions[i]);
+	}
+
+	inline void advance(std::vector<vec3> & storedPositions, std::vector<vec3> & storedOldPositions, int i, const accumulatorVec3 & position) {
+		oldPositions[i] = this->position(storedPositions, i);
+		storedOldPositions[i] = storedPositions[i];
+		positions[i] = position;
+		storedPositions[i] = vec3(position);
+	}
+};
+
+template <typename P>
+class AccumulatedPositionsT<P, false> {
+private:
+	typedef typename P::vec3 vec3;
+
+public:
+	void resize(int) {}
+
+	inline const vec3 & position(const std::vector<vec3> & storedPositions, int i) {
+		return storedPositions[i];
+	}
+
+	inline const vec3 & oldPosition(const std::vector<vec3> & storedOldPositions, int i) {
+		return storedOldPositions[i];
+	}
+
+	inline void advance(std::vector<vec3> & storedPositions, std::vector<vec3> & storedOldPositions, int i, const vec3 & position) {
+		storedOldPositions[i] = storedPositions[i];
+		storedPositions[i] = position;
+	}
+};
+
+// Particle data of all objects of a world. Every object owns a contiguous range of it, so a single global index
+// identifies any particle and constraints between objects need no references to the other object's vectors.
+template <typename P>
+class ParticleStoreT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+public:
+	std::vector<vec3> positions;
+	std::vector<vec3> oldPositions;
+	std::vector<vec3> velocities;
+	std::vector<vec3> accelerations;
+	std::vector<scalar> masses;
+	std::vector<bool> isMovables;
+	std::vector<scalar> radii; // for collisions between particles, 0 leaves the particle out of them
+	std::vector<int> groups; // particles of the same group do not collide with each other
+
+	AccumulatedPositionsT<P> accumulatedPositions;
+
+	//Appends count particles at rest with unit mass and returns the global index of the first one. They form a
+	//group of their own, identified by that index.
+	int allocate(int count) {
+		int first = size();
+		positions.resize(first + count, vec3(0, 0, 0));
+		oldPositions.resize(first + count, vec3(0, 0, 0));
+		velocities.resize(first + count, vec3(0, 0, 0));
+		accelerations.resize(first + count, vec3(0, 0, 0));
+		masses.resize(first + count, 1);
+		isMovables.resize(first + count, true);
+		radii.resize(first + count, 0);
+		groups.resize(first + count, first);
+		accumulatedPositions.resize(first + count);
+		return first;
+	}
+
+	//Position of particle i in the accumulator precision
+	inline accumulatorVec3 accumulatedPosition(int i) {
+		return accumulatedPositions.position(positions, i);
+	}
+
+	inline accumulatorVec3 accumulatedOldPosition(int i) {
+		return accumulatedPositions.oldPosition(oldPositions, i);
+	}
+
+	//Moves particle i to its integrated position, the current one becomes the old one. Positions thereby accumulate
+	//in the accumulator precision over many steps, while the other passes and the renderers only see storage.
+	inline void advancePosition(int i, const accumulatorVec3 & position) {
+		accumulatedPositions.advance(positions, oldPositions, i, position);
+	}
+
+	int size() {
+		return (int)positions.size();
+	}
+};
+
+typedef ParticleStoreT<WorldPrecision> ParticleStore;
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+
+// Hardware performance counters per solver phase. Only active on Linux when PERF_COUNTERS is defined,
+// everywhere else the profiler compiles to empty calls so the solver can always be instrumented.
+#if defined(PERF_COUNTERS) && defined(__linux__)
+#define PERF_COUNTERS_AVAILABLE
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdint>
+#endif
+
+enum SolverPhase { integrationPhase, constraintPhase, collisionPhase, numberOfSolverPhases };
+enum PerfCounter { cpuCycles, instructionsRetired, l1DataMisses, lastLevelCacheMisses, branchMisses, numberOfPerfCounters };
+
+class PhaseProfiler {
+private:
+	unsigned long long totals[numberOfSolverPhases][numberOfPerfCounters];
+	unsigned long long startValues[numberOfSolverPhases][numberOfPerfCounters];
+	int samples[numberOfSolverPhases];
+	bool started[numberOfSolverPhases]; // false if the counters could not be read at the begin of the phase
+	bool available = false;
+
+#ifdef PERF_COUNTERS_AVAILABLE
+	int fds[numberOfPerfCounters];
+	int slots[numberOfPerfCounters]; // position of each counter in the group read, -1 if it could not be opened
+	int numberOfOpenCounters = 0;
+
+	int openCounter(unsigned int type, unsigned long long config, int groupFd) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = type;
+		attr.config = config;
+		attr.disabled = groupFd == -1 ? 1 : 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+	}
+
+	//reads all counters of the group at once into values (indexed by PerfCounter), false if the read failed
+	bool readCounters(unsigned long long * values) {
+		uint64_t buffer[1 + numberOfPerfCounters];
+		if (read(fds[cpuCycles], buffer, sizeof(buffer)) <= 0)
+			return false;
+		for (int i = 0; i < numberOfPerfCounters; i++)
+			values[i] = slots[i] == -1 ? 0 : buffer[1 + slots[i]];
+		return true;
+	}
+#endif
+
+public:
+	PhaseProfiler() {
+		reset();
+#ifdef PERF_COUNTERS_AVAILABLE
+		const unsigned long long l1Miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		const unsigned long long llcMiss = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+		//the cycle counter leads the group, the others are optional since VMs often lack the cache events
+		fds[cpuCycles] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+		if (fds[cpuCycles] == -1) {
+			std::cout << "perf_event_open failed, performance counters disabled (check /proc/sys/kernel/perf_event_paranoid)\n";
+			return;
+		}
+		fds[instructionsRetired] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, fds[cpuCycles]);
+		fds[l1DataMisses] = openCounter(PERF_TYPE_HW_CACHE, l1Miss, fds[cpuCycles]);
+		fds[lastLevelCacheMisses] = openCounter(PERF_TYPE_HW_CACHE, llcMiss, fds[cpuCycles]);
+		fds[branchMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, fds[cpuCycles]);
+
+		for (int i = 0; i < numberOfPerfCounters; i++)
+			slots[i] = fds[i] == -1 ? -1 : numberOfOpenCounters++;
+
+		ioctl(fds[cpuCycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(fds[cpuCycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		available = true;
+#endif
+	}
+
+	~PhaseProfiler() {
+#ifdef PERF_COUNTERS_AVAILABLE
+		if (!available)
+			return;
+		ioctl(fds[cpuCycles], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		for (int i = numberOfPerfCounters - 1; i >= 0; i--)
+			if (fds[i] != -1)
+				close(fds[i]);
+#endif
+	}
+
+#ifdef PERF_COUNTERS_AVAILABLE
+	inline void begin(SolverPhase phase) {
+		if (available)
+			started[phase] = readCounters(startValues[phase]);
+	}
+
+	inline void end(SolverPhase phase) {
+		if (!available)
+			return;
+		//a sample with a failed read is dropped instead of adding garbage to the totals
+		unsigned long long endValues[numberOfPerfCounters];
+		if (!started[phase] || !readCounters(endValues))
+			return;
+		for (int i = 0; i < numberOfPerfCounters; i++)
+			totals[phase][i] += endValues[i] - startValues[phase][i];
+		samples[phase]++;
+	}
+#else
+	inline void begin(SolverPhase) {}
+
+	inline void end(SolverPhase) {}
+#endif
+
+	void reset() {
+		for (int phase = 0; phase < numberOfSolverPhases; phase++) {
+			for (int i = 0; i < numberOfPerfCounters; i++) {
+				totals[phase][i] = 0;
+				startValues[phase][i] = 0;
+			}
+			samples[phase] = 0;
+			started[phase] = false;
+		}
+	}
+
+	bool isAvailable() {
+		return available;
+	}
+
+	//prints the accumulated counters of every phase and starts a new measurement window
+	void print() {
+		if (!available)
+			return;
+		const char * phaseNames[numberOfSolverPhases] = { "integration", "constraints", "collision" };
+		std::cout << std::setw(12) << "phase" << std::setw(8) << "calls" << std::setw(14) << "cycles" << std::setw(14) << "instructions"
+			<< std::setw(6) << "IPC" << std::setw(12) << "L1D miss" << std::setw(12) << "LLC miss" << std::setw(12) << "br miss" << "\n";
+		for (int phase = 0; phase < numberOfSolverPhases; phase++) {
+			unsigned long long * t = totals[phase];
+			float ipc = t[cpuCycles] > 0 ? (float)t[instructionsRetired] / t[cpuCycles] : 0.f;
+			std::cout << std::setw(12) << phaseNames[phase] << std::setw(8) << samples[phase] << std::setw(14) << t[cpuCycles]
+				<< std::setw(14) << t[instructionsRetired] << std::setw(6) << std::setprecision(2) << std::fixed << ipc
+				<< std::setw(12) << t[l1DataMisses] << std::setw(12) << t[lastLevelCacheMisses] << std::setw(12) << t[branchMisses] << "\n";
+		}
+		std::cout.unsetf(std::ios::fixed);
+		reset();
+	}
+};
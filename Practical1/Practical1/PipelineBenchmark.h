@@ -0,0 +1,145 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include "Solver.h"
+#include "SolverPipeline.h"
+
+// Runs the rope and character configurations once through the generic Solver and once through their SolverPipeline
+// specialization and compares the time. Both paths do the same arithmetic in the same order, so the deviation
+// between them has to be 0.
+class PipelineBenchmark {
+private:
+	int numberOfParticles;
+	int numberOfSteps;
+	int constraintIterations;
+	SCALAR timeStepSize;
+	SCALAR segmentLength;
+	SCALAR gravity;
+
+	std::vector<PlaneCollider*> planes;
+	std::vector<AABBCollider*> boxes;
+
+	//horizontal chain pinned at the first particle
+	void setupRope(ParticleStore & particles, std::vector<Constraint> & constraints) {
+		particles.allocate(numberOfParticles);
+		for (int i = 0; i < numberOfParticles; i++)
+			particles.positions[i] = vec3(i * segmentLength, 4, 0);
+		particles.isMovables[0] = false;
+		particles.oldPositions = particles.positions;
+		for (int i = 0; i < numberOfParticles - 1; i++)
+			constraints.push_back(Constraint(i, i + 1, particles.positions, 0));
+	}
+
+	//fully connected cubes of eight particles like the body of the character, spread over the arena
+	void setupBodies(ParticleStore & particles, std::vector<Constraint> & constraints) {
+		int numberOfBodies = numberOfParticles / 8;
+		particles.allocate(numberOfBodies * 8);
+		for (int b = 0; b < numberOfBodies; b++) {
+			vec3 center = vec3(-11 + SCALAR(15.5) * b / numberOfBodies, 1 + SCALAR(b % 5) * segmentLength * 4, 0);
+			for (int i = 0; i < 8; i++)
+				particles.positions[b * 8 + i] = center + segmentLength * vec3(SCALAR(i & 1), SCALAR((i >> 1) & 1), SCALAR((i >> 2) & 1));
+			for (int i = 0; i < 8; i++) {
+				for (int j = i + 1; j < 8; j++)
+					constraints.push_back(Constraint(b * 8 + i, b * 8 + j, particles.positions, 0));
+			}
+		}
+		particles.oldPositions = particles.positions;
+	}
+
+	void addGravity(ParticleStore & particles) {
+		for (int i = 0; i < particles.size(); i++)
+			particles.accelerations[i] += vec3(0, gravity, 0) / particles.masses[i];
+	}
+
+	double maxDeviation(ParticleStore & a, ParticleStore & b) {
+		double deviation = 0.0;
+		for (int i = 0; i < a.size(); i++)
+			deviation = glm::max(deviation, glm::distance(glm::dvec3(a.positions[i]), glm::dvec3(b.positions[i])));
+		return deviation;
+	}
+
+	void setColliders(NoCollisionPolicy<WorldPrecision> &) {}
+
+	void setColliders(StaticColliderPolicy<WorldPrecision> & policy) {
+		policy.planes = planes;
+		policy.boxes = boxes;
+	}
+
+	template <typename Pipeline>
+	void compare(const char * name, IntegrationScheme scheme, ConstraintSolveMode mode, bool withColliders,
+		void (PipelineBenchmark::*setup)(ParticleStore &, std::vector<Constraint> &)) {
+		std::vector<Collider*> colliders;
+		for (PlaneCollider * plane : planes)
+			colliders.push_back(plane);
+		for (AABBCollider * box : boxes)
+			colliders.push_back(box);
+
+		ParticleStore genericParticles;
+		std::vector<Constraint> genericConstraints;
+		std::vector<ConnectorConstraint> connectors;
+		(this->*setup)(genericParticles, genericConstraints);
+		Solver solver(scheme, genericParticles, 0, genericParticles.size(), genericConstraints, connectors);
+		solver.setConstraintIterations(constraintIterations);
+		solver.setConstraintSolveMode(mode);
+		if (withColliders)
+			solver.setColliders(colliders);
+
+		ParticleStore pipelineParticles;
+		std::vector<Constraint> pipelineConstraints;
+		(this->*setup)(pipelineParticles, pipelineConstraints);
+		Pipeline pipeline(pipelineParticles, 0, pipelineParticles.size(), pipelineConstraints);
+		pipeline.setConstraintIterations(constraintIterations);
+		setColliders(pipeline.getCollisionPolicy());
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (int step = 0; step < numberOfSteps; step++) {
+			addGravity(genericParticles);
+			solver.evaluateVerlet(timeStepSize, false);
+		}
+		std::chrono::duration<double, std::milli> genericTime = std::chrono::high_resolution_clock::now() - startTime;
+
+		startTime = std::chrono::high_resolution_clock::now();
+		for (int step = 0; step < numberOfSteps; step++) {
+			addGravity(pipelineParticles);
+			pipeline.step(timeStepSize, false);
+		}
+		std::chrono::duration<double, std::milli> pipelineTime = std::chrono::high_resolution_clock::now() - startTime;
+
+		std::cout << name << ": generic " << genericTime.count() << " ms, pipeline " << pipelineTime.count()
+			<< " ms, max deviation " << maxDeviation(genericParticles, pipelineParticles) << std::endl;
+	}
+
+public:
+	//The bodies fall into an arena of its own (floor, two walls and a box) so that no trigger of the level fires.
+	PipelineBenchmark(int numberOfParticles, int numberOfSteps, int constraintIterations, SCALAR timeStepSize, SCALAR segmentLength, SCALAR gravity, GLhandleARB shaderProgramId) {
+		this->numberOfParticles = numberOfParticles;
+		this->numberOfSteps = numberOfSteps;
+		this->constraintIterations = constraintIterations;
+		this->timeStepSize = timeStepSize;
+		this->segmentLength = segmentLength;
+		this->gravity = gravity;
+
+		planes.push_back(new PlaneCollider(vec3(0, 0, 0), vec3(0, 1, 0), shaderProgramId));
+		planes.push_back(new PlaneCollider(vec3(-11.5, 0, 0), vec3(1, 0, 0), shaderProgramId));
+		planes.push_back(new PlaneCollider(vec3(5, 0, 0), vec3(-1, 0, 0), shaderProgramId));
+		boxes.push_back(new AABBCollider(vec3(-4, 0.5, 0), 1, 1, shaderProgramId));
+	}
+
+	~PipelineBenchmark() {
+		for (PlaneCollider * plane : planes)
+			delete plane;
+		for (AABBCollider * box : boxes)
+			delete box;
+	}
+
+	void run() {
+		std::cout << "Pipeline benchmark: " << numberOfParticles << " particles, " << numberOfSteps << " steps" << std::endl;
+		compare<RopePipeline>("rope     ", positionVerlet, directChain, false, &PipelineBenchmark::setupRope);
+
+		//the character pipeline only knows planes and boxes, the generic solver gets the same colliders in the same order
+		compare<CharacterPipeline>("character", symplecticEuler, iterativeConstraints, true, &PipelineBenchmark::setupBodies);
+	}
+};
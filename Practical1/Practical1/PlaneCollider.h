@@ -1,16 +1,21 @@
 #pragma once
 
 #include "Collider.h"
+#include "PlaneRenderer.h"
 
-class PlaneCollider : public Collider {
+template <typename P>
+class PlaneColliderT : public ColliderT<P> {
 private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+
 	vec3 normal;
 	vec3 position;
 	bool isGameEndTrigger;
 	bool isGameFailed;
 
 public:
-	PlaneCollider(vec3 position, vec3 normal, GLhandleARB shaderProgramId) : Collider() {
+	PlaneColliderT(vec3 position, vec3 normal, GLhandleARB shaderProgramId) : ColliderT<P>() {
 		this->position = position;
 		this->normal = normal;
 		this->isGameEndTrigger = isGameEndTrigger;
@@ -18,21 +23,21 @@ public:
 		this->isGameEndTrigger = false;
 		this->isGameFailed = false;
 
-		renderer = new PlaneRenderer(shaderProgramId, position, -normal);
-		renderer->setupOpenGLBuffers();
+		this->renderer = new PlaneRenderer(shaderProgramId, ::vec3(position), -::vec3(normal));
+		this->renderer->setupOpenGLBuffers();
 	}
 
-	PlaneCollider(vec3 position, vec3 normal, GLhandleARB shaderProgramId, bool isGameEndTrigger) : Collider() {
+	PlaneColliderT(vec3 position, vec3 normal, GLhandleARB shaderProgramId, bool isGameEndTrigger) : ColliderT<P>() {
 		this->position = position;
 		this->normal = normal;
 		this->isGameEndTrigger = isGameEndTrigger;
 
-		renderer = new PlaneRenderer(shaderProgramId, position, -normal);
-		renderer->setupOpenGLBuffers();
+		this->renderer = new PlaneRenderer(shaderProgramId, ::vec3(position), -::vec3(normal));
+		this->renderer->setupOpenGLBuffers();
 	}
 
 	void handleCollision(vec3 & particlePosition) {
-		float dot = glm::dot((particlePosition - position), normal);
+		scalar dot = glm::dot((particlePosition - position), normal);
 		if (dot < 0) {
 			particlePosition -= normal * dot;
 			if (isGameEndTrigger && !isGameFailed) {
@@ -42,6 +47,10 @@ public:
 		}
 	}
 
+	scalar getDistance(const vec3 & particlePosition) {
+		return glm::dot(particlePosition - position, normal) / glm::length(normal);
+	}
+
 	vec3 getPosition() {
 		return position;
 	}
@@ -49,4 +58,11 @@ public:
 	void setPosition(vec3 position) {
 		this->position = position;
 	}
-};
\ No newline at end of file
+
+	void shiftOrigin(const vec3 & shift) {
+		position -= shift;
+		ColliderT<P>::shiftOrigin(shift);
+	}
+};
+
+typedef PlaneColliderT<WorldPrecision> PlaneCollider;
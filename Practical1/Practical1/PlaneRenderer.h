@@ -11,8 +11,8 @@ public:
 		Renderer(shaderProgramId) {
 
 		//draw line perpendicular to the normal through the position (i.e. draw the edge)
-		positions.push_back(position + 50.f * vec3(normal.y, -normal.x, 0));
-		positions.push_back(position - 50.f * vec3(normal.y, -normal.x, 0));
+		positions.push_back(position + SCALAR(50) * vec3(normal.y, -normal.x, 0));
+		positions.push_back(position - SCALAR(50) * vec3(normal.y, -normal.x, 0));
 
 		numberOfVertices = positions.size();
 
@@ -50,4 +50,9 @@ public:
 		glDisableVertexAttribArray(vertexNormalAttribLocation);
 	}
 
+	void shiftOrigin(const vec3 & shift) {
+		for (vec3 & position : positions) {
+			position -= shift;
+		}
+	}
 };
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "Platform.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void beginHighResolutionTimer() {
+#ifdef _WIN32
+	timeBeginPeriod(1);
+#endif
+}
+
+void endHighResolutionTimer() {
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+bool mapFile(const std::string & filename, MappedFile & mappedFile) {
+	mappedFile = MappedFile();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	mappedFile.file = file;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		unmapFile(mappedFile);
+		return false;
+	}
+	mappedFile.mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappedFile.mapping != NULL)
+		mappedFile.data = MapViewOfFile(mappedFile.mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mappedFile.data == nullptr) {
+		unmapFile(mappedFile);
+		return false;
+	}
+	mappedFile.size = (size_t)fileSize.QuadPart;
+	return true;
+#else
+	int descriptor = open(filename.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return false;
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+		close(descriptor);
+		return false;
+	}
+	void * mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (mapped == MAP_FAILED)
+		return false;
+	mappedFile.data = mapped;
+	mappedFile.size = (size_t)status.st_size;
+	return true;
+#endif
+}
+
+void unmapFile(MappedFile & mappedFile) {
+#ifdef _WIN32
+	if (mappedFile.data != nullptr)
+		UnmapViewOfFile(mappedFile.data);
+	if (mappedFile.mapping != nullptr)
+		CloseHandle(mappedFile.mapping);
+	if (mappedFile.file != nullptr)
+		CloseHandle(mappedFile.file);
+#else
+	if (mappedFile.data != nullptr)
+		munmap(const_cast<void *>(mappedFile.data), mappedFile.size);
+#endif
+	mappedFile = MappedFile();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// The operating system calls of the game. They live in Platform.cpp, so windows.h and its macros (min, max, near,
+// far, ...) stay inside of that translation unit instead of reaching every header that includes this one.
+
+//Raises the resolution of the system timer to 1 ms for as long as the frame pacer sleeps, the default on Windows is
+//~15.6 ms. Nothing to do on the other systems.
+void beginHighResolutionTimer();
+void endHighResolutionTimer();
+
+// A read only view of a whole file, mapped into memory
+struct MappedFile {
+	const void * data = nullptr;
+	size_t size = 0;
+	void * file = nullptr; // handles of the file and the mapping on Windows
+	void * mapping = nullptr;
+};
+
+//Maps the file, returns false with nothing left open if it cannot be read
+bool mapFile(const std::string & filename, MappedFile & mappedFile);
+void unmapFile(MappedFile & mappedFile);
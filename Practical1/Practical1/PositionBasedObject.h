@@ -1,35 +1,39 @@
 #pragma once
 
+#include <queue>
+#include <functional>
+#include <limits>
+
 #include "Solver.h"
 #include "Renderer.h"
 
-#ifdef DOUBLE_PRECISION
-typedef glm::dvec3 vec3;
-#define SCALAR double
-#define GL_SCALAR GL_DOUBLE
-#else
-typedef glm::vec3 vec3;
-#define SCALAR float
-#define GL_SCALAR GL_FLOAT
-#endif
-
 
 class PositionBasedObject {
 protected:
-	//The cloth consists of a grid of particles. The particle properties are stored in the following vectors:
-	std::vector<vec3> positions;
-	std::vector<vec3> oldPositions;
-	std::vector<vec3> velocities;
-	std::vector<vec3> accelerations;
-	std::vector<SCALAR> masses;
-	std::vector<bool> isMovables;
-	std::vector<Constraint> constraints; // constraints between the particles
+	//The particles of this object are the range [firstParticle, firstParticle + numberOfParticles) of the shared store:
+	ParticleStore & particles;
+	int firstParticle;
+	int numberOfParticles;
+	bool simulated = true;
+	std::vector<Constraint> constraints; // constraints between the particles, relative to firstParticle
+	std::vector<ConnectorConstraint> connectors; // constraints to particles of other objects, global indices
+	std::vector<Constraint> longRangeAttachments; // max distance from each particle to its closest pinned particle
+
+	inline vec3 & position(int i) { return particles.positions[firstParticle + i]; }
+	inline vec3 & oldPosition(int i) { return particles.oldPositions[firstParticle + i]; }
+	inline vec3 & velocity(int i) { return particles.velocities[firstParticle + i]; }
+	inline vec3 & acceleration(int i) { return particles.accelerations[firstParticle + i]; }
+	inline SCALAR & mass(int i) { return particles.masses[firstParticle + i]; }
+
+	inline void setMovable(int i, bool isMovable) {
+		particles.isMovables[firstParticle + i] = isMovable;
+	}
 
 	//Method for calculating the triangle normal:
 	vec3 calcTriangleNormal(int p1, int p2, int p3) {
-		vec3 pos1 = positions[p1];
-		vec3 pos2 = positions[p2];
-		vec3 pos3 = positions[p3];
+		vec3 pos1 = position(p1);
+		vec3 pos2 = position(p2);
+		vec3 pos3 = position(p3);
 
 		vec3 v1 = pos2 - pos1;
 		vec3 v2 = pos3 - pos1;
@@ -43,29 +47,27 @@ protected:
 		vec3 d = glm::normalize(normal);
 		vec3 force = normal * (glm::dot(d, direction));
 
-		accelerations[p1] += force / masses[p1];
-		accelerations[p2] += force / masses[p2];
-		accelerations[p3] += force / masses[p3];
+		acceleration(p1) += force / mass(p1);
+		acceleration(p2) += force / mass(p2);
+		acceleration(p3) += force / mass(p3);
 	}
 
 	void makeConstraint(int p1, int p2) {
-		constraints.push_back(Constraint(p1, p2, positions, isMovables));
+		constraints.push_back(Constraint(static_cast<ConstraintIndex>(p1), static_cast<ConstraintIndex>(p2), particles.positions, firstParticle));
 	}
 
-
-	void makeConstraint(int p1, std::vector<vec3> & positions1, std::vector<bool> & isMovables1, int p2, std::vector<vec3> & positions2, std::vector<bool> & isMovables2) {
-		constraints.push_back(Constraint(p1, positions1, isMovables1, p2, positions2, isMovables2));
-	}
-
-	void makeConstraint(int p1, std::vector<vec3> & positions1, std::vector<bool> & isMovables1, int p2, std::vector<vec3> & positions2, std::vector<bool> & isMovables2, SCALAR restDist) {
-		constraints.push_back(Constraint(p1, positions1, isMovables1, p2, positions2, isMovables2, restDist));
+	//Connects particle p1 of this object to the particle with global index p2:
+	void makeConnector(int p1, int p2, SCALAR restDist) {
+		connectors.push_back(ConnectorConstraint(firstParticle + p1, p2, restDist));
 	}
 
 public:
 	Solver * solver;
 	Renderer * renderer;
 	
-	PositionBasedObject() {
+	PositionBasedObject(ParticleStore & particles, int numberOfParticles) : particles(particles) {
+		this->numberOfParticles = numberOfParticles;
+		firstParticle = particles.allocate(numberOfParticles);
 	}
 
 	~PositionBasedObject() {
@@ -78,12 +80,103 @@ public:
 		solver->evaluateVerlet(timeStepSize, dragEnabled);
 	}
 	
+	//Moves all particles when the floating origin is rebased, velocities are unaffected:
+	virtual void shiftOrigin(const vec3 & shift) {
+		for (int i = 0; i < numberOfParticles; i++) {
+			position(i) -= shift;
+			oldPosition(i) -= shift;
+		}
+	}
+
 	//Adds a force uniformly to all particles:
 	void addForce(const vec3 direction) {
-		for (int i = 0; i < accelerations.size(); i++) {
-			accelerations[i] += direction / masses[i];
+		for (int i = 0; i < numberOfParticles; i++) {
+			acceleration(i) += direction / mass(i);
 		}
 	}
 
+	//Radius of the particles in collisions with particles of other objects, 0 turns them off:
+	virtual void setParticleRadius(SCALAR radius) {
+		for (int i = 0; i < numberOfParticles; i++) {
+			particles.radii[firstParticle + i] = radius;
+		}
+	}
+
+	//objects that are not simulated are skipped by the World, e.g. the character before the game starts
+	bool isSimulated() {
+		return simulated;
+	}
+
+	void setSimulated(bool simulated) {
+		this->simulated = simulated;
+	}
+
+	//Tethers every movable particle to the pinned particle that is closest along the constraints, with the rest
+	//length of that path as maximum distance. Keeps anchored objects from stretching with few iterations.
+	void makeLongRangeAttachments() {
+		typedef std::pair<SCALAR, int> QueueEntry;
+
+		std::vector<std::vector<std::pair<int, SCALAR> > > neighbors(numberOfParticles);
+		for (Constraint & constraint : constraints) {
+			neighbors[constraint.getP1()].push_back(std::make_pair(constraint.getP2(), constraint.getRestDistance()));
+			neighbors[constraint.getP2()].push_back(std::make_pair(constraint.getP1(), constraint.getRestDistance()));
+		}
+
+		//Dijkstra from all pinned particles at once
+		std::vector<SCALAR> distances(numberOfParticles, std::numeric_limits<SCALAR>::max());
+		std::vector<int> anchors(numberOfParticles, -1);
+		std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > queue;
+		for (int i = 0; i < numberOfParticles; i++) {
+			if (!particles.isMovables[firstParticle + i]) {
+				distances[i] = 0;
+				anchors[i] = i;
+				queue.push(QueueEntry(SCALAR(0), i));
+			}
+		}
+		while (!queue.empty()) {
+			QueueEntry entry = queue.top();
+			queue.pop();
+			if (entry.first > distances[entry.second])
+				continue;
+			for (std::pair<int, SCALAR> & neighbor : neighbors[entry.second]) {
+				SCALAR distance = entry.first + neighbor.second;
+				if (distance < distances[neighbor.first]) {
+					distances[neighbor.first] = distance;
+					anchors[neighbor.first] = anchors[entry.second];
+					queue.push(QueueEntry(distance, neighbor.first));
+				}
+			}
+		}
+
+		longRangeAttachments.clear();
+		for (int i = 0; i < numberOfParticles; i++) {
+			if (anchors[i] != -1 && anchors[i] != i)
+				longRangeAttachments.push_back(Constraint(static_cast<ConstraintIndex>(anchors[i]), static_cast<ConstraintIndex>(i), distances[i]));
+		}
+		solver->setLongRangeAttachments(&longRangeAttachments);
+	}
+
+	void removeLongRangeAttachments() {
+		longRangeAttachments.clear();
+		solver->setLongRangeAttachments(NULL);
+	}
+
+	std::vector<Constraint> & getConstraints() {
+		return constraints;
+	}
+
+	//whether the constraints are pieces of a thin body that collide as capsules, like the segments of a rope
+	virtual bool hasCollidingSegments() {
+		return false;
+	}
+
+	int getFirstParticle() {
+		return firstParticle;
+	}
+
+	int getNumberOfParticles() {
+		return numberOfParticles;
+	}
+
 	virtual void reinitialize(IntegrationScheme integrationScheme) = 0;
 };
\ No newline at end of file
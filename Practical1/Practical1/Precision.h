@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+template <typename T> struct GLScalarType;
+template <> struct GLScalarType<float> { static const GLenum value = GL_FLOAT; };
+template <> struct GLScalarType<double> { static const GLenum value = GL_DOUBLE; };
+
+// Scalar types of a simulation world. Particle data is stored as Storage, while integration and constraint
+// projection are computed in Accumulator and rounded to Storage once per update. The store also keeps the integrated
+// positions in Accumulator, so with a wider Accumulator long-running positions accumulate in it.
+template <typename Storage, typename Accumulator = Storage>
+struct Precision {
+	typedef Storage scalar;
+	typedef Accumulator accumulator;
+	typedef glm::vec<3, Storage> vec3;
+	typedef glm::vec<3, Accumulator> accumulatorVec3;
+	static const GLenum glType = GLScalarType<Storage>::value;
+};
+
+typedef Precision<float> SinglePrecision;
+typedef Precision<double> DoublePrecision;
+typedef Precision<float, double> MixedPrecision;
+
+// Precision of the game world (objects, renderers and colliders used by Main)
+#if defined(DOUBLE_PRECISION)
+typedef DoublePrecision WorldPrecision;
+#elif defined(MIXED_PRECISION)
+typedef MixedPrecision WorldPrecision;
+#else
+typedef SinglePrecision WorldPrecision;
+#endif
+
+typedef WorldPrecision::vec3 vec3;
+typedef WorldPrecision::scalar SCALAR;
+#define GL_SCALAR (WorldPrecision::glType)
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include "Solver.h"
+
+// Simulates the same swinging chain headless in double, single and mixed precision so that cost and accuracy
+// can be compared within one binary. The double run is the reference for the position error.
+class PrecisionBenchmark {
+private:
+	int numberOfParticles;
+	int numberOfSteps;
+	int constraintIterations;
+	double timeStepSize;
+	double segmentLength;
+	double gravity;
+
+	std::vector<glm::dvec3> reference;
+
+	template <typename P>
+	void runChain(const char * name) {
+		typedef typename P::scalar scalar;
+		typedef typename P::vec3 vec3;
+
+		ParticleStoreT<P> particles;
+		particles.allocate(numberOfParticles);
+		std::vector<vec3> & positions = particles.positions;
+		std::vector<vec3> & accelerations = particles.accelerations;
+		std::vector<scalar> & masses = particles.masses;
+		std::vector<ConstraintT<P, ConstraintIndex> > constraints;
+		std::vector<ConstraintT<P> > connectors;
+
+		//horizontal chain pinned at the first particle
+		for (int i = 0; i < numberOfParticles; i++)
+			positions[i] = vec3(scalar(i * segmentLength), 0, 0);
+		particles.isMovables[0] = false;
+		particles.oldPositions = positions;
+
+		for (int i = 0; i < numberOfParticles - 1; i++)
+			constraints.push_back(ConstraintT<P, ConstraintIndex>(i, i + 1, positions, 0));
+
+		SolverT<P> solver(positionVerlet, particles, 0, numberOfParticles, constraints, connectors);
+		solver.setConstraintIterations(constraintIterations);
+		solver.setDragConstant(0);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		for (int step = 0; step < numberOfSteps; step++) {
+			for (int i = 0; i < numberOfParticles; i++)
+				accelerations[i] += vec3(0, scalar(gravity), 0) / masses[i];
+			solver.evaluateVerlet(scalar(timeStepSize), false);
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+
+		double maxError = 0.0;
+		if (reference.empty()) {
+			for (vec3 & position : positions)
+				reference.push_back(glm::dvec3(position));
+		}
+		else {
+			for (int i = 0; i < numberOfParticles; i++)
+				maxError = glm::max(maxError, glm::distance(glm::dvec3(positions[i]), reference[i]));
+		}
+
+		std::cout << name << ": " << elapsed.count() << " ms, max deviation from double " << maxError << std::endl;
+	}
+
+public:
+	PrecisionBenchmark(int numberOfParticles, int numberOfSteps, int constraintIterations, double timeStepSize, double segmentLength, double gravity) {
+		this->numberOfParticles = numberOfParticles;
+		this->numberOfSteps = numberOfSteps;
+		this->constraintIterations = constraintIterations;
+		this->timeStepSize = timeStepSize;
+		this->segmentLength = segmentLength;
+		this->gravity = gravity;
+	}
+
+	void run() {
+		std::cout << "Precision benchmark: " << numberOfParticles << " particles, " << numberOfSteps << " steps" << std::endl;
+		reference.clear();
+		runChain<DoublePrecision>("double");
+		runChain<SinglePrecision>("single");
+		runChain<MixedPrecision>("mixed ");
+	}
+};
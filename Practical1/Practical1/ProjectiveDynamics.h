@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Constraint.h"
+#include "ParticleStore.h"
+
+// Projective dynamics (Bouaziz et al. 2014) for the distance constraints of one object. Every iteration is
+//   local step:  p_j = restDistance_j * (x_a - x_b) / |x_a - x_b|  for every constraint, independently
+//   global step: (M / h^2 + sum w A_j^T A_j) x = M / h^2 s + sum w A_j^T p_j
+// where s are the positions after integration and A_j x = x_a - x_b. The system matrix only depends on the
+// topology, the masses, the pinned particles and h, so its Cholesky factorization is cached. The substepper and the
+// quality governor change h from frame to frame, so h is rounded to one of STEP_SIZE_LEVELS_PER_OCTAVE levels per
+// octave and a factor is kept for each level in use; the rounded h only shifts the balance between inertia and the
+// constraints by a few percent. All factors are dropped when the topology changes, e.g. when a connector is added.
+// A connector pulls its particle inside the object towards the current position of the other end, which is kept
+// fixed in the global step. The matrices are dense, which is fine for the small objects of the game.
+template <typename P>
+class ProjectiveDynamicsSolverT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	static const int STEP_SIZE_LEVELS_PER_OCTAVE = 8;
+	static const int MAX_FACTORS = 8;
+
+	// Cholesky factor of the system matrix for one level of the step size
+	struct Factor {
+		int level;
+		accumulator timeStepSize; // h of the level, which the right hand side has to use as well
+		std::vector<accumulator> lower; // lower triangle L of L L^T, row major numberOfUnknowns^2
+	};
+
+	int numberOfUnknowns = 0;
+	std::vector<int> unknowns; // unknown of each particle of the object, -1 for pinned particles
+	std::vector<Factor> factors; // least recently used first
+	std::vector<accumulatorVec3> inertialPositions, projections, rightHandSide;
+	std::vector<accumulator> violations;
+
+	//the topology the factors were built for
+	scalar factoredWeight = 0;
+	int factoredConstraints = -1;
+	std::vector<unsigned int> factoredConnectors;
+	std::vector<bool> factoredMovables;
+
+	inline void addToMatrix(std::vector<accumulator> & matrix, int a, int b, accumulator value) {
+		if (a >= 0 && b >= 0)
+			matrix[a * numberOfUnknowns + b] += value;
+	}
+
+	//the end of the connector inside [firstParticle, firstParticle + numberOfParticles), -1 if none
+	template <typename Index>
+	static inline int localEnd(ConstraintT<P, Index> & connector, int firstParticle, int numberOfParticles, int & other) {
+		if (connector.getP1() >= firstParticle && connector.getP1() < firstParticle + numberOfParticles) {
+			other = connector.getP2();
+			return connector.getP1() - firstParticle;
+		}
+		if (connector.getP2() >= firstParticle && connector.getP2() < firstParticle + numberOfParticles) {
+			other = connector.getP1();
+			return connector.getP2() - firstParticle;
+		}
+		return -1;
+	}
+
+	template <typename Index>
+	bool topologyChanged(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles,
+		std::vector<ConstraintT<P, Index> > & constraints, std::vector<ConstraintT<P> > & connectors, scalar weight) {
+		if (weight != factoredWeight || (int)constraints.size() != factoredConstraints || connectors.size() != factoredConnectors.size())
+			return true;
+		for (int k = 0; k < (int)connectors.size(); k++) {
+			if ((unsigned int)connectors[k].getP1() != factoredConnectors[k])
+				return true;
+		}
+		for (int i = 0; i < numberOfParticles; i++) {
+			if (particles.isMovables[firstParticle + i] != factoredMovables[i])
+				return true;
+		}
+		return false;
+	}
+
+	template <typename Index>
+	void setTopology(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles,
+		std::vector<ConstraintT<P, Index> > & constraints, std::vector<ConstraintT<P> > & connectors, scalar weight) {
+		factors.clear();
+		unknowns.assign(numberOfParticles, -1);
+		numberOfUnknowns = 0;
+		factoredMovables.resize(numberOfParticles);
+		for (int i = 0; i < numberOfParticles; i++) {
+			factoredMovables[i] = particles.isMovables[firstParticle + i];
+			if (factoredMovables[i])
+				unknowns[i] = numberOfUnknowns++;
+		}
+		factoredConnectors.clear();
+		for (ConstraintT<P> & connector : connectors)
+			factoredConnectors.push_back(connector.getP1());
+		factoredConstraints = (int)constraints.size();
+		factoredWeight = weight;
+	}
+
+	template <typename Index>
+	void factor(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles,
+		std::vector<ConstraintT<P, Index> > & constraints, std::vector<ConstraintT<P> > & connectors, scalar weight, Factor & factor) {
+		//assemble M / h^2 + sum w A^T A
+		std::vector<accumulator> & matrix = factor.lower;
+		matrix.assign(numberOfUnknowns * numberOfUnknowns, accumulator(0));
+		accumulator inverseTimeStepSizeSquared = accumulator(1) / (factor.timeStepSize * factor.timeStepSize);
+		for (int i = 0; i < numberOfParticles; i++)
+			addToMatrix(matrix, unknowns[i], unknowns[i], accumulator(particles.masses[firstParticle + i]) * inverseTimeStepSizeSquared);
+		for (ConstraintT<P, Index> & constraint : constraints) {
+			int a = unknowns[constraint.getP1()], b = unknowns[constraint.getP2()];
+			addToMatrix(matrix, a, a, weight);
+			addToMatrix(matrix, b, b, weight);
+			addToMatrix(matrix, a, b, -weight);
+			addToMatrix(matrix, b, a, -weight);
+		}
+		for (ConstraintT<P> & connector : connectors) {
+			int other;
+			int a = localEnd(connector, firstParticle, numberOfParticles, other);
+			if (a >= 0)
+				addToMatrix(matrix, unknowns[a], unknowns[a], weight);
+		}
+
+		//in place Cholesky factorization, the matrix is symmetric positive definite thanks to the mass term
+		int n = numberOfUnknowns;
+		for (int j = 0; j < n; j++) {
+			accumulator diagonal = matrix[j * n + j];
+			for (int k = 0; k < j; k++)
+				diagonal -= matrix[j * n + k] * matrix[j * n + k];
+			diagonal = glm::sqrt(diagonal);
+			matrix[j * n + j] = diagonal;
+			for (int i = j + 1; i < n; i++) {
+				accumulator value = matrix[i * n + j];
+				for (int k = 0; k < j; k++)
+					value -= matrix[i * n + k] * matrix[j * n + k];
+				matrix[i * n + j] = value / diagonal;
+			}
+		}
+	}
+
+public:
+	//Makes the factor for the level of the step size the most recently used one, factoring it only if the topology
+	//changed or the level has none yet, and remembers the positions after integration, the inertial term of the
+	//global step
+	template <typename Index>
+	void beginStep(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles,
+		std::vector<ConstraintT<P, Index> > & constraints, std::vector<ConstraintT<P> > & connectors, scalar timeStepSize, scalar weight) {
+		if (topologyChanged(particles, firstParticle, numberOfParticles, constraints, connectors, weight))
+			setTopology(particles, firstParticle, numberOfParticles, constraints, connectors, weight);
+
+		int level = (int)std::lround(STEP_SIZE_LEVELS_PER_OCTAVE * std::log2(double(timeStepSize)));
+		int k = 0;
+		while (k < (int)factors.size() && factors[k].level != level)
+			k++;
+		if (k == (int)factors.size()) {
+			if (k == MAX_FACTORS) {
+				factors.erase(factors.begin());
+				k--;
+			}
+			Factor newFactor;
+			newFactor.level = level;
+			newFactor.timeStepSize = accumulator(std::exp2(double(level) / STEP_SIZE_LEVELS_PER_OCTAVE));
+			factors.push_back(newFactor);
+			factor(particles, firstParticle, numberOfParticles, constraints, connectors, weight, factors.back());
+		}
+		else
+			std::rotate(factors.begin() + k, factors.begin() + k + 1, factors.end());
+
+		inertialPositions.resize(numberOfParticles);
+		for (int i = 0; i < numberOfParticles; i++)
+			inertialPositions[i] = accumulatorVec3(particles.positions[firstParticle + i]);
+	}
+
+	//One local and global iteration. The violation of every constraint before it is added to the residual statistics.
+	template <typename Index>
+	void iterate(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles,
+		std::vector<ConstraintT<P, Index> > & constraints, std::vector<ConstraintT<P> > & connectors, scalar weight,
+		accumulator & maxResidual, accumulator & squaredResidualSum) {
+		std::vector<vec3> & positions = particles.positions;
+		int numberOfConstraints = (int)constraints.size();
+		projections.resize(numberOfConstraints);
+		violations.resize(numberOfConstraints);
+
+		//local step, every constraint only writes its own projection
+		#pragma omp parallel for if (numberOfConstraints > 256)
+		for (int j = 0; j < numberOfConstraints; j++) {
+			accumulatorVec3 vec = accumulatorVec3(positions[firstParticle + constraints[j].getP1()]) - accumulatorVec3(positions[firstParticle + constraints[j].getP2()]);
+			accumulator length = glm::length(vec);
+			projections[j] = length > accumulator(0) ? vec * (accumulator(constraints[j].getRestDistance()) / length) : vec;
+			violations[j] = glm::abs(length - accumulator(constraints[j].getRestDistance()));
+		}
+		for (int j = 0; j < numberOfConstraints; j++) {
+			maxResidual = glm::max(maxResidual, violations[j]);
+			squaredResidualSum += violations[j] * violations[j];
+		}
+
+		//right hand side M / h^2 s + sum w A^T p, with the pinned particles moved over from the left side
+		int n = numberOfUnknowns;
+		rightHandSide.assign(n, accumulatorVec3(0, 0, 0));
+		const Factor & current = factors.back();
+		accumulator inverseTimeStepSizeSquared = accumulator(1) / (current.timeStepSize * current.timeStepSize);
+		for (int i = 0; i < numberOfParticles; i++) {
+			if (unknowns[i] >= 0)
+				rightHandSide[unknowns[i]] += accumulator(particles.masses[firstParticle + i]) * inverseTimeStepSizeSquared * inertialPositions[i];
+		}
+		for (int j = 0; j < numberOfConstraints; j++) {
+			int p1 = constraints[j].getP1(), p2 = constraints[j].getP2();
+			int a = unknowns[p1], b = unknowns[p2];
+			accumulatorVec3 projection = accumulator(weight) * projections[j];
+			if (a >= 0)
+				rightHandSide[a] += projection + (b < 0 ? accumulator(weight) * accumulatorVec3(positions[firstParticle + p2]) : accumulatorVec3(0, 0, 0));
+			if (b >= 0)
+				rightHandSide[b] += -projection + (a < 0 ? accumulator(weight) * accumulatorVec3(positions[firstParticle + p1]) : accumulatorVec3(0, 0, 0));
+		}
+		for (ConstraintT<P> & connector : connectors) {
+			int other;
+			int a = localEnd(connector, firstParticle, numberOfParticles, other);
+			if (a < 0 || unknowns[a] < 0)
+				continue;
+			accumulatorVec3 vec = accumulatorVec3(positions[firstParticle + a]) - accumulatorVec3(positions[other]);
+			accumulator length = glm::length(vec);
+			accumulatorVec3 projection = length > accumulator(0) ? vec * (accumulator(connector.getRestDistance()) / length) : accumulatorVec3(0, 0, 0);
+			rightHandSide[unknowns[a]] += accumulator(weight) * (accumulatorVec3(positions[other]) + projection);
+		}
+
+		//global step: forward and back substitution with the cached factor
+		const std::vector<accumulator> & L = current.lower;
+		for (int i = 0; i < n; i++) {
+			accumulatorVec3 value = rightHandSide[i];
+			for (int k = 0; k < i; k++)
+				value -= L[i * n + k] * rightHandSide[k];
+			rightHandSide[i] = value / L[i * n + i];
+		}
+		for (int i = n - 1; i >= 0; i--) {
+			accumulatorVec3 value = rightHandSide[i];
+			for (int k = i + 1; k < n; k++)
+				value -= L[k * n + i] * rightHandSide[k];
+			rightHandSide[i] = value / L[i * n + i];
+		}
+
+		for (int i = 0; i < numberOfParticles; i++) {
+			if (unknowns[i] >= 0)
+				positions[firstParticle + i] = vec3(rightHandSide[unknowns[i]]);
+		}
+	}
+};
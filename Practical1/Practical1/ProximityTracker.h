@@ -0,0 +1,190 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "ParticleStore.h"
+
+// Reported when a seeker particle comes closer than the threshold to a target particle or leaves that distance again.
+struct ProximityEvent {
+	int seeker, target; // global indices
+	bool entered;
+};
+
+// Tracks which seeker particles (the hands of the character) are within a threshold of which target particles (the
+// rope particles) with sweep and prune: every particle is a box of the threshold around it, and the box bounds are
+// kept sorted along each axis across updates. Particles move little between updates, so insertion sort restores the
+// order in about linear time, and every swap of a lower with an upper bound is exactly a pair of boxes starting or
+// stopping to overlap on that axis. Only pairs whose boxes overlap on all three axes have their distance checked,
+// so an update costs next to nothing while no target is near a seeker.
+template <typename P>
+class ProximityTrackerT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	struct Bound {
+		accumulator value;
+		int box; // seekers first, then targets
+		bool isLower;
+	};
+
+	scalar threshold;
+	std::vector<int> boxParticles; // global index of every box
+	int numberOfSeekers = 0, numberOfTargets = 0;
+	std::vector<Bound> axes[3];
+
+	//per pair of seeker s and target t at s * numberOfTargets + t
+	std::vector<int> overlappingAxes;
+	std::vector<bool> withinThreshold;
+	std::vector<int> candidates; // pairs overlapping on all axes
+	std::vector<int> candidateSlots; // position of a pair in candidates, -1 if none
+
+	std::vector<ProximityEvent> events;
+
+	inline int pairIndex(int boxA, int boxB) {
+		int seeker = glm::min(boxA, boxB), target = glm::max(boxA, boxB) - numberOfSeekers;
+		return seeker * numberOfTargets + target;
+	}
+
+	inline bool isSeeker(int box) {
+		return box < numberOfSeekers;
+	}
+
+	void addCandidate(int pair) {
+		candidateSlots[pair] = (int)candidates.size();
+		candidates.push_back(pair);
+	}
+
+	void removeCandidate(int pair) {
+		int slot = candidateSlots[pair];
+		candidates[slot] = candidates.back();
+		candidateSlots[candidates[slot]] = slot;
+		candidates.pop_back();
+		candidateSlots[pair] = -1;
+		if (withinThreshold[pair]) {
+			withinThreshold[pair] = false;
+			events.push_back(leaveEvent(pair));
+		}
+	}
+
+	ProximityEvent leaveEvent(int pair) {
+		ProximityEvent event = { boxParticles[pair / numberOfTargets], boxParticles[numberOfSeekers + pair % numberOfTargets], false };
+		return event;
+	}
+
+	//The boxes started (+1) or stopped (-1) overlapping on one axis
+	void changeOverlap(int boxA, int boxB, int change) {
+		if (isSeeker(boxA) == isSeeker(boxB))
+			return;
+		int pair = pairIndex(boxA, boxB);
+		overlappingAxes[pair] += change;
+		if (overlappingAxes[pair] == 3)
+			addCandidate(pair);
+		else if (change < 0 && overlappingAxes[pair] == 2)
+			removeCandidate(pair);
+	}
+
+	void updateBounds(std::vector<Bound> & axis, int dimension, const std::vector<vec3> & positions) {
+		accumulator halfThreshold = accumulator(0.5) * threshold;
+		for (Bound & bound : axis) {
+			accumulator center = accumulator(positions[boxParticles[bound.box]][dimension]);
+			bound.value = bound.isLower ? center - halfThreshold : center + halfThreshold;
+		}
+	}
+
+public:
+	ProximityTrackerT(scalar threshold) {
+		this->threshold = threshold;
+	}
+
+	//Starts tracking, the first update reports the pairs that are near already
+	void setParticles(const std::vector<int> & seekers, const std::vector<int> & targets, const std::vector<vec3> & positions) {
+		numberOfSeekers = (int)seekers.size();
+		numberOfTargets = (int)targets.size();
+		boxParticles = seekers;
+		boxParticles.insert(boxParticles.end(), targets.begin(), targets.end());
+		int numberOfPairs = numberOfSeekers * numberOfTargets;
+		overlappingAxes.assign(numberOfPairs, 0);
+		withinThreshold.assign(numberOfPairs, false);
+		candidateSlots.assign(numberOfPairs, -1);
+		candidates.clear();
+
+		//sort every axis once and sweep it for the overlaps it starts with
+		for (int dimension = 0; dimension < 3; dimension++) {
+			std::vector<Bound> & axis = axes[dimension];
+			axis.clear();
+			for (int box = 0; box < (int)boxParticles.size(); box++) {
+				Bound lower = { 0, box, true }, upper = { 0, box, false };
+				axis.push_back(lower);
+				axis.push_back(upper);
+			}
+			updateBounds(axis, dimension, positions);
+			std::sort(axis.begin(), axis.end(), [](const Bound & a, const Bound & b) {
+				return a.value < b.value || (a.value == b.value && a.isLower && !b.isLower);
+			});
+
+			std::vector<int> open;
+			for (Bound & bound : axis) {
+				if (bound.isLower) {
+					for (int other : open) {
+						if (isSeeker(other) != isSeeker(bound.box))
+							overlappingAxes[pairIndex(other, bound.box)]++;
+					}
+					open.push_back(bound.box);
+				}
+				else
+					open.erase(std::find(open.begin(), open.end(), bound.box));
+			}
+		}
+		for (int pair = 0; pair < numberOfPairs; pair++) {
+			if (overlappingAxes[pair] == 3)
+				addCandidate(pair);
+		}
+		events.clear();
+	}
+
+	//Moves the boxes to the current positions and collects the events since the last update
+	void update(const std::vector<vec3> & positions) {
+		events.clear();
+		for (int dimension = 0; dimension < 3; dimension++) {
+			std::vector<Bound> & axis = axes[dimension];
+			updateBounds(axis, dimension, positions);
+
+			//insertion sort, a bound moving below another one changes the overlap of their boxes
+			for (int k = 1; k < (int)axis.size(); k++) {
+				Bound bound = axis[k];
+				int j = k - 1;
+				while (j >= 0 && bound.value < axis[j].value) {
+					if (bound.isLower && !axis[j].isLower)
+						changeOverlap(bound.box, axis[j].box, 1);
+					else if (!bound.isLower && axis[j].isLower)
+						changeOverlap(bound.box, axis[j].box, -1);
+					axis[j + 1] = axis[j];
+					j--;
+				}
+				axis[j + 1] = bound;
+			}
+		}
+
+		//exact distances of the pairs whose boxes overlap
+		for (int pair : candidates) {
+			int seeker = boxParticles[pair / numberOfTargets], target = boxParticles[numberOfSeekers + pair % numberOfTargets];
+			bool isNear = glm::distance(accumulatorVec3(positions[seeker]), accumulatorVec3(positions[target])) < accumulator(threshold);
+			if (isNear != withinThreshold[pair]) {
+				withinThreshold[pair] = isNear;
+				ProximityEvent event = { seeker, target, isNear };
+				events.push_back(event);
+			}
+		}
+	}
+
+	const std::vector<ProximityEvent> & getEvents() {
+		return events;
+	}
+};
+
+typedef ProximityTrackerT<WorldPrecision> ProximityTracker;
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <iostream>
+
+// Adjusts the number of simulation substeps and constraint iterations so that the solver stays within a fixed
+// share of the frame. Quality is only changed after the measured time stayed outside the hysteresis band for
+// several consecutive frames, and every change is reported.
+class QualityGovernor {
+private:
+	double frameBudget;				// solver seconds allowed per frame
+	double lowerThreshold = 0.6;	// quality is raised again once the solver needs less than this share of the budget
+	int framesRequired = 30;		// consecutive frames outside the band before adjusting
+
+	int minSubsteps, maxSubsteps;
+	int minIterations, maxIterations;
+	int substeps, constraintIterations;
+
+	double averageSolverTime = 0.0;
+	int overBudgetFrames = 0;
+	int underBudgetFrames = 0;
+	int numberOfAdjustments = 0;
+
+	void printAdjustment(const char * reason, int oldSubsteps, int oldIterations) {
+		std::cout << "[governor] " << reason << ": solver " << averageSolverTime * 1000.0 << " ms / budget " << frameBudget * 1000.0
+			<< " ms, substeps " << oldSubsteps << " -> " << substeps
+			<< ", constraint iterations " << oldIterations << " -> " << constraintIterations
+			<< " (adjustment #" << numberOfAdjustments << ")" << std::endl;
+	}
+
+	//degrade iterations first since they cost less stability than substeps
+	bool decreaseQuality() {
+		if (constraintIterations > minIterations)
+			constraintIterations--;
+		else if (substeps > minSubsteps)
+			substeps--;
+		else
+			return false;
+		return true;
+	}
+
+	bool increaseQuality() {
+		if (substeps < maxSubsteps)
+			substeps++;
+		else if (constraintIterations < maxIterations)
+			constraintIterations++;
+		else
+			return false;
+		return true;
+	}
+
+public:
+	QualityGovernor(double frameBudget, int substeps, int minSubsteps, int maxSubsteps,
+		int constraintIterations, int minIterations, int maxIterations) {
+		this->frameBudget = frameBudget;
+		this->substeps = substeps;
+		this->minSubsteps = minSubsteps;
+		this->maxSubsteps = maxSubsteps;
+		this->constraintIterations = constraintIterations;
+		this->minIterations = minIterations;
+		this->maxIterations = maxIterations;
+	}
+
+	//Feeds the solver time of the last frame. Returns true if the substeps or iterations changed.
+	bool reportSolverTime(double seconds) {
+		averageSolverTime = averageSolverTime == 0.0 ? seconds : 0.9 * averageSolverTime + 0.1 * seconds;
+
+		if (seconds > frameBudget) {
+			overBudgetFrames++;
+			underBudgetFrames = 0;
+		}
+		else if (seconds < lowerThreshold * frameBudget) {
+			underBudgetFrames++;
+			overBudgetFrames = 0;
+		}
+		else {
+			overBudgetFrames = 0;
+			underBudgetFrames = 0;
+		}
+
+		int oldSubsteps = substeps;
+		int oldIterations = constraintIterations;
+		bool adjusted = false;
+		const char * reason = "";
+
+		if (overBudgetFrames >= framesRequired) {
+			adjusted = decreaseQuality();
+			reason = "over budget";
+		}
+		else if (underBudgetFrames >= framesRequired) {
+			//only step up if the higher setting is expected to fit, otherwise we would oscillate
+			double expectedTime = averageSolverTime * (substeps + 1) / substeps;
+			if (substeps == maxSubsteps)
+				expectedTime = averageSolverTime * (constraintIterations + 1) / constraintIterations;
+			if (expectedTime < frameBudget)
+				adjusted = increaseQuality();
+			reason = "under budget";
+		}
+
+		if (overBudgetFrames >= framesRequired || underBudgetFrames >= framesRequired) {
+			overBudgetFrames = 0;
+			underBudgetFrames = 0;
+		}
+
+		if (adjusted) {
+			numberOfAdjustments++;
+			printAdjustment(reason, oldSubsteps, oldIterations);
+		}
+		return adjusted;
+	}
+
+	void setFrameBudget(double frameBudget) {
+		this->frameBudget = frameBudget;
+	}
+
+	int getSubsteps() {
+		return substeps;
+	}
+
+	int getConstraintIterations() {
+		return constraintIterations;
+	}
+
+	double getAverageSolverTime() {
+		return averageSolverTime;
+	}
+
+	int getNumberOfAdjustments() {
+		return numberOfAdjustments;
+	}
+};
@@ -1,14 +1,6 @@
 #pragma once
 
-#ifdef DOUBLE_PRECISION
-typedef glm::dvec3 vec3;
-#define SCALAR double
-#define GL_SCALAR GL_DOUBLE
-#else
-typedef glm::vec3 vec3;
-#define SCALAR float
-#define GL_SCALAR GL_FLOAT
-#endif
+#include "Precision.h"
 
 class Renderer {
 
@@ -28,10 +20,15 @@ public:
 
 	}
 
+	virtual ~Renderer() {}
+
 	virtual void setupOpenGLBuffers() = 0;
 	virtual void draw() = 0;
 
 	void setNormals(std::vector<vec3> & normals) {
 		this->normals = normals;
 	}
+
+	//renderers that keep their own copy of vertex positions have to move them with the floating origin
+	virtual void shiftOrigin(const vec3 &) {}
 };
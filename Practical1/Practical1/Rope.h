@@ -8,16 +8,15 @@ class Rope : public PositionBasedObject {
 private:
 
 	std::vector<vec3> normals;
-	int numberOfParticles;
 	vec3 anchor;
 	float size;
 
 	//TODO: radnom particle displacement
 	void initializePositions(float angle) {
 		for (int i = 0; i < numberOfParticles; i++) {
-			positions[i] = anchor + vec3((float)i*(sin(angle)*size), i*-cos(angle)*size, 0.f);
+			position(i) = anchor + vec3((float)i*(sin(angle)*size), i*-cos(angle)*size, 0.f);
 		}
-		isMovables[0] = false;
+		setMovable(0, false);
 	}
 
 	void initializeConstraints() {
@@ -26,26 +25,17 @@ private:
 	}
 
 public:
-	Rope(IntegrationScheme integrationScheme, GLhandleARB shaderProgramId, float size, vec3 anchor, float angle) :
-		PositionBasedObject() {
+	Rope(IntegrationScheme integrationScheme, ParticleStore & particles, GLhandleARB shaderProgramId, float size, vec3 anchor, float angle) :
+		PositionBasedObject(particles, 10) {
 		this->size = size;
 		this->anchor = anchor;
-		numberOfParticles = 10;
 
-		positions.resize(numberOfParticles);
-		oldPositions.resize(numberOfParticles);
-		accelerations.resize(numberOfParticles, vec3(0, 0, 0));
-
-		masses.resize(numberOfParticles, 1);
-		isMovables.resize(numberOfParticles, true);
-		velocities.resize(numberOfParticles, vec3(0, 0, 0));
-
-		solver = new Solver(integrationScheme, positions, oldPositions, velocities, accelerations, masses, isMovables, constraints);
-		renderer = new ParticleNetworkRenderer(shaderProgramId, positions, constraints, numberOfParticles);
+		solver = new Solver(integrationScheme, particles, firstParticle, numberOfParticles, constraints, connectors);
+		renderer = new ParticleNetworkRenderer(shaderProgramId, particles.positions, firstParticle, constraints, numberOfParticles);
 
 		initializePositions(angle);
-		for (int i = 0; i < positions.size(); i++) {
-			oldPositions[i] = positions[i];
+		for (int i = 0; i < numberOfParticles; i++) {
+			oldPosition(i) = position(i);
 		}
 		initializeConstraints();
 
@@ -58,23 +48,24 @@ public:
 		solver->setIntegrationScheme(currentIntegrationScheme);
 		solver->setToFirstTimeStep();
 
-		std::fill(accelerations.begin(), accelerations.end(), vec3(0, 0, 0));
-		std::fill(velocities.begin(), velocities.end(), vec3(0, 0, 0));
-
-		oldPositions.resize(numberOfParticles);
+		for (int i = 0; i < numberOfParticles; i++) {
+			acceleration(i) = vec3(0, 0, 0);
+			velocity(i) = vec3(0, 0, 0);
+		}
 
 		initializePositions(0);
 
-		for (int i = 0; i < positions.size(); i++) {
-			oldPositions[i] = positions[i];
+		for (int i = 0; i < numberOfParticles; i++) {
+			oldPosition(i) = position(i);
 		}
 	}
 
-	std::vector<vec3>* getPositions() {
-		return &positions;
+	bool hasCollidingSegments() {
+		return true;
 	}
 
-	std::vector<bool>* getIsMovables() {
-		return &isMovables;
+	void shiftOrigin(const vec3 & shift) {
+		PositionBasedObject::shiftOrigin(shift);
+		anchor -= shift;
 	}
 };
\ No newline at end of file
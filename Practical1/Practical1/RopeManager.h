@@ -1,50 +1,95 @@
 #include "Rope.h"
+#include "World.h"
 
 class RopeManager {
 private:
 	std::vector<Rope*> ropes;
+	ParticleStore & particles;
 	int ropeCount;
 public:
 #pragma once
-	RopeManager(GLhandleARB shaderProgramId, int constraintIterations, int dragConstant, float ropeSize, vec3 offset) {
+	RopeManager(IntegrationScheme integrationScheme, ParticleStore & particles, GLhandleARB shaderProgramId, int constraintIterations, SCALAR dragConstant, float ropeSize, vec3 offset) :
+		particles(particles) {
 		ropeCount = 5;
 		float ropeDistance = 1.2f*ropeSize;
 		for (int i = 0; i < ropeCount; i++) {
-			Rope *rope = new Rope(verlet, shaderProgramId, ropeSize, offset + vec3(2-i*ropeDistance*10, 0,0), 70*(1-2*(i%2)));
+			Rope *rope = new Rope(integrationScheme, particles, shaderProgramId, ropeSize, offset + vec3(2-i*ropeDistance*10, 0,0), 70*(1-2*(i%2)));
 			rope->solver->setConstraintIterations(constraintIterations);
 			rope->solver->setDragConstant(dragConstant);
 			ropes.push_back(rope);
 		}
 	}
 	
-	// find the particle in all ropes that is closest to the particle parameter
-	Particle getClosestParticle(vec3 particle, float threshold) {
-		Particle closestParticle;
-		closestParticle.id =-1;
+	//global indices of the particles of all ropes
+	std::vector<int> getParticles() {
+		std::vector<int> ropeParticles;
+		for (Rope* rope : ropes) {
+			for (int i = 0; i < rope->getNumberOfParticles(); i++)
+				ropeParticles.push_back(rope->getFirstParticle() + i);
+		}
+		return ropeParticles;
+	}
+
+	void addToWorld(World * world) {
+		for (Rope* rope : ropes) {
+			world->addObject(rope);
+		}
+	}
+
+	void setConstraintSolveMode(ConstraintSolveMode constraintSolveMode) {
+		for (Rope* rope : ropes) {
+			rope->solver->setConstraintSolveMode(constraintSolveMode);
+		}
+	}
+
+	void setProjectiveDynamicsWeight(SCALAR projectiveDynamicsWeight) {
+		for (Rope* rope : ropes) {
+			rope->solver->setProjectiveDynamicsWeight(projectiveDynamicsWeight);
+		}
+	}
+
+	void setLongRangeAttachments(bool enabled) {
+		for (Rope* rope : ropes) {
+			if (enabled)
+				rope->makeLongRangeAttachments();
+			else
+				rope->removeLongRangeAttachments();
+		}
+	}
+
+	void setParticleRadius(SCALAR radius) {
+		for (Rope* rope : ropes) {
+			rope->setParticleRadius(radius);
+		}
+	}
+
+	void setIntegrationScheme(IntegrationScheme integrationScheme) {
+		for (Rope* rope : ropes) {
+			rope->solver->setIntegrationScheme(integrationScheme);
+		}
+	}
+
+	void setSpringStiffness(SCALAR springStiffness, SCALAR springDamping) {
+		for (Rope* rope : ropes) {
+			rope->solver->setSpringStiffness(springStiffness, springDamping);
+		}
+	}
+
+	void setChebyshevAcceleration(bool enabled, SCALAR spectralRadius, int warmUpIterations) {
+		for (Rope* rope : ropes) {
+			rope->solver->setChebyshevAcceleration(enabled, spectralRadius, warmUpIterations);
+		}
+	}
 
-		float closestDistance = 10.f;
+	void addForce(const vec3 direction) {
 		for (Rope* rope : ropes) {
-			std::vector<vec3> * ropePositions = rope->getPositions();
-			std::vector<bool> * ropeIsMovables = rope->getIsMovables();
-			int i = 0;
-			for (vec3 pos : *ropePositions) {
-				float dist = glm::distance(particle, pos);
-				if (dist < threshold) {
-					if (dist < closestDistance) {
-						closestParticle = { i, ropePositions , ropeIsMovables };
-						dist = closestDistance;
-					}
-				}
-				i++;
-			}
+			rope->addForce(direction);
 		}
-		return closestParticle;
 	}
 
-	void timeStep(float gravity, float deltaTime){
+	void shiftOrigin(const vec3 & shift) {
 		for (Rope* rope : ropes) {
-			rope->addForce(vec3(0, gravity, 0));
-			rope->timeStep(deltaTime, false);
+			rope->shiftOrigin(shift);
 		}
 	}
 
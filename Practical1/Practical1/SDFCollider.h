@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Collider.h"
+#include "DistanceGrid.h"
+#include "SDFRenderer.h"
+
+// Static level geometry of any shape given by a distance grid. A particle inside is pushed out along the gradient of
+// the distance by the distance, which takes one grid lookup however many boxes the grid was baked from.
+template <typename P>
+class SDFColliderT : public ColliderT<P> {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	DistanceGridT<P> * grid;
+
+	//Outline of the layer of the grid closest to z = 0 by marching squares, as pairs of line end points
+	std::vector<::vec3> contour() {
+		glm::ivec3 size = grid->getSize();
+		accumulatorVec3 origin = grid->getOrigin();
+		accumulator cellSize = grid->getCellSize();
+		int z = size.z == 1 ? 0 : glm::clamp(int(glm::round(-origin.z / cellSize)), 0, size.z - 1);
+		accumulator layerZ = size.z == 1 ? accumulator(0) : origin.z + z * cellSize;
+
+		std::vector<::vec3> lines;
+		for (int y = 0; y + 1 < size.y; y++) {
+			for (int x = 0; x + 1 < size.x; x++) {
+				//corners and edges counterclockwise from the lower left
+				const int cornerX[4] = { x, x + 1, x + 1, x };
+				const int cornerY[4] = { y, y, y + 1, y + 1 };
+				std::vector<::vec3> crossings;
+				for (int edge = 0; edge < 4; edge++) {
+					int a = edge, b = (edge + 1) % 4;
+					float da = grid->getDistance(cornerX[a], cornerY[a], z), db = grid->getDistance(cornerX[b], cornerY[b], z);
+					if ((da < 0) == (db < 0))
+						continue;
+					accumulator t = da / (da - db);
+					accumulator crossingX = glm::mix(accumulator(cornerX[a]), accumulator(cornerX[b]), t);
+					accumulator crossingY = glm::mix(accumulator(cornerY[a]), accumulator(cornerY[b]), t);
+					crossings.push_back(::vec3(origin.x + crossingX * cellSize, origin.y + crossingY * cellSize, layerZ));
+				}
+				//saddles give four crossings, they are paired along the edges
+				lines.insert(lines.end(), crossings.begin(), crossings.end());
+			}
+		}
+		return lines;
+	}
+
+public:
+	//takes ownership of the grid
+	SDFColliderT(DistanceGridT<P> * grid, GLhandleARB shaderProgramId) : ColliderT<P>() {
+		this->grid = grid;
+
+		this->renderer = new SDFRenderer(shaderProgramId, contour());
+		this->renderer->setupOpenGLBuffers();
+	}
+
+	~SDFColliderT() {
+		delete grid;
+	}
+
+	void handleCollision(vec3 & particlePosition) {
+		accumulatorVec3 gradient;
+		accumulator distance = grid->sample(accumulatorVec3(particlePosition), gradient);
+		if (distance < 0) {
+			accumulator length = glm::length(gradient);
+			if (length > 0)
+				particlePosition = vec3(accumulatorVec3(particlePosition) - distance / length * gradient);
+		}
+	}
+
+	scalar getDistance(const vec3 & particlePosition) {
+		accumulatorVec3 gradient;
+		return scalar(grid->sample(accumulatorVec3(particlePosition), gradient));
+	}
+
+	scalar getThickness() {
+		return grid->getThickness();
+	}
+
+	DistanceGridT<P> & getGrid() {
+		return *grid;
+	}
+
+	void shiftOrigin(const vec3 & shift) {
+		grid->shiftOrigin(shift);
+		ColliderT<P>::shiftOrigin(shift);
+	}
+};
+
+typedef SDFColliderT<WorldPrecision> SDFCollider;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Renderer.h"
+
+class SDFRenderer : public Renderer {
+private:
+	std::vector<vec3> positions;
+
+public:
+	//draws the outline of a distance field given as pairs of line end points
+	SDFRenderer(GLhandleARB shaderProgramId, const std::vector<vec3> & lines) : Renderer(shaderProgramId) {
+		positions = lines;
+		numberOfVertices = positions.size();
+		normals.resize(positions.size(), vec3(0, 0, 0));
+	}
+
+	void setupOpenGLBuffers() {
+		glGenBuffers(1, &vertexPosBufferHandle);
+		glGenBuffers(1, &vertexNormalBufferHandle);
+
+		vertexPosAttribLocation = glGetAttribLocation(shaderProgramId, "vertexPos");
+		vertexNormalAttribLocation = glGetAttribLocation(shaderProgramId, "vertexNormal");
+		colorLocation = glGetUniformLocation(shaderProgramId, "color");
+	}
+
+	void draw() {
+		if (numberOfVertices == 0)
+			return;
+		glEnableVertexAttribArray(vertexPosAttribLocation);
+		glEnableVertexAttribArray(vertexNormalAttribLocation);
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexPosBufferHandle);
+		glVertexAttribPointer(vertexPosAttribLocation, 3, GL_SCALAR, GL_FALSE, 0, NULL);
+		glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(vec3), &(positions[0]), GL_DYNAMIC_DRAW);
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexNormalBufferHandle);
+		glVertexAttribPointer(vertexNormalAttribLocation, 3, GL_SCALAR, GL_FALSE, 0, NULL);
+		glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(vec3), &(normals[0]), GL_DYNAMIC_DRAW);
+
+		glUniform4f(colorLocation, 0, 1, 0, 1);
+		glDrawArrays(GL_LINES, 0, numberOfVertices);
+		glDisableVertexAttribArray(vertexNormalAttribLocation);
+	}
+
+	void shiftOrigin(const vec3 & shift) {
+		for (vec3 & position : positions) {
+			position -= shift;
+		}
+	}
+};
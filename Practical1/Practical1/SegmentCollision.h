@@ -0,0 +1,284 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <glm/glm.hpp>
+
+#include "Constraint.h"
+#include "ParticleStore.h"
+
+// Collisions between the constraints of different objects taken as capsules, e.g. between two ropes, so thin ropes
+// cannot slip through each other between their particles. The radius of a capsule is the larger radius of its two
+// particles, capsules with radius 0 and capsules of the same group are left out. The capsules are kept in a
+// bounding volume hierarchy that is only built when the set of capsules changes and refit bottom up every step.
+// An overlapping pair is pushed apart at its closest points, the correction is shared between the four particles
+// by their inverse masses and their weight in the closest points, like the constraints. Each capsule only gathers
+// the correction of its own two particles, so the queries run in parallel over the capsules.
+template <typename P>
+class SegmentCollisionT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	struct Segment {
+		int p1, p2; // global indices
+	};
+
+	//children follow their parent, so refitting the nodes in reverse order visits every child before its parent
+	struct Node {
+		accumulatorVec3 lower, upper;
+		int left, right;
+		int segment; // for leaves, -1 for inner nodes
+	};
+
+	std::vector<Segment> segments;
+	std::vector<Segment> builtSegments; // the segments the hierarchy was built for
+	std::vector<Node> nodes;
+	std::vector<accumulator> radii, inverseMasses1, inverseMasses2;
+	std::vector<int> groups;
+
+	std::vector<accumulatorVec3> segmentCorrections; // of p1 and p2 of every segment
+	std::vector<int> segmentContacts;
+	std::vector<accumulatorVec3> particleCorrections; // indexed like the store
+	std::vector<int> particleContacts;
+	int numberOfContacts = 0;
+
+	inline accumulatorVec3 position(ParticleStoreT<P> & particles, int i) {
+		return accumulatorVec3(particles.positions[i]);
+	}
+
+	int build(ParticleStoreT<P> & particles, std::vector<int> & order, int first, int last) {
+		int node = (int)nodes.size();
+		nodes.push_back(Node());
+		if (last - first == 1) {
+			nodes[node].left = nodes[node].right = -1;
+			nodes[node].segment = order[first];
+			return node;
+		}
+
+		//median split of the centers along the longest axis of their bounds
+		accumulatorVec3 lower = accumulatorVec3(std::numeric_limits<accumulator>::max());
+		accumulatorVec3 upper = -lower;
+		for (int k = first; k < last; k++) {
+			accumulatorVec3 center = accumulator(0.5) * (position(particles, segments[order[k]].p1) + position(particles, segments[order[k]].p2));
+			lower = glm::min(lower, center);
+			upper = glm::max(upper, center);
+		}
+		accumulatorVec3 extent = upper - lower;
+		int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		int middle = (first + last) / 2;
+		std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last, [&](int a, int b) {
+			return position(particles, segments[a].p1)[axis] + position(particles, segments[a].p2)[axis]
+				< position(particles, segments[b].p1)[axis] + position(particles, segments[b].p2)[axis];
+		});
+
+		nodes[node].segment = -1;
+		int left = build(particles, order, first, middle);
+		int right = build(particles, order, middle, last);
+		nodes[node].left = left;
+		nodes[node].right = right;
+		return node;
+	}
+
+	void refit(ParticleStoreT<P> & particles) {
+		for (int k = (int)nodes.size() - 1; k >= 0; k--) {
+			Node & node = nodes[k];
+			if (node.segment >= 0) {
+				accumulatorVec3 a = position(particles, segments[node.segment].p1);
+				accumulatorVec3 b = position(particles, segments[node.segment].p2);
+				accumulatorVec3 radius = accumulatorVec3(radii[node.segment]);
+				node.lower = glm::min(a, b) - radius;
+				node.upper = glm::max(a, b) + radius;
+			}
+			else {
+				node.lower = glm::min(nodes[node.left].lower, nodes[node.right].lower);
+				node.upper = glm::max(nodes[node.left].upper, nodes[node.right].upper);
+			}
+		}
+	}
+
+	bool isBuiltFor() {
+		if (builtSegments.size() != segments.size())
+			return false;
+		for (int s = 0; s < (int)segments.size(); s++) {
+			if (builtSegments[s].p1 != segments[s].p1 || builtSegments[s].p2 != segments[s].p2)
+				return false;
+		}
+		return true;
+	}
+
+	//Closest points of the segments a0 a1 and b0 b1 as a0 + s (a1 - a0) and b0 + t (b1 - b0), after Ericson,
+	//"Real-Time Collision Detection", 5.1.9
+	static void closestPoints(const accumulatorVec3 & a0, const accumulatorVec3 & a1, const accumulatorVec3 & b0, const accumulatorVec3 & b1,
+		accumulator & s, accumulator & t) {
+		const accumulator epsilon = accumulator(1.0e-12);
+		accumulatorVec3 d1 = a1 - a0, d2 = b1 - b0, r = a0 - b0;
+		accumulator a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+		if (a <= epsilon && e <= epsilon) {
+			s = t = 0;
+			return;
+		}
+		if (a <= epsilon) {
+			s = 0;
+			t = glm::clamp(f / e, accumulator(0), accumulator(1));
+			return;
+		}
+		accumulator c = glm::dot(d1, r);
+		if (e <= epsilon) {
+			t = 0;
+			s = glm::clamp(-c / a, accumulator(0), accumulator(1));
+			return;
+		}
+		accumulator b = glm::dot(d1, d2);
+		accumulator denominator = a * e - b * b;
+		s = denominator > epsilon ? glm::clamp((b * f - c * e) / denominator, accumulator(0), accumulator(1)) : accumulator(0);
+		t = (b * s + f) / e;
+		if (t < 0) {
+			t = 0;
+			s = glm::clamp(-c / a, accumulator(0), accumulator(1));
+		}
+		else if (t > 1) {
+			t = 1;
+			s = glm::clamp((b - c) / a, accumulator(0), accumulator(1));
+		}
+	}
+
+	//Correction of the particles of segment i for its contact with segment j
+	inline void collide(ParticleStoreT<P> & particles, int i, int j, accumulatorVec3 & correction1, accumulatorVec3 & correction2, int & contacts) {
+		accumulatorVec3 a0 = position(particles, segments[i].p1), a1 = position(particles, segments[i].p2);
+		accumulatorVec3 b0 = position(particles, segments[j].p1), b1 = position(particles, segments[j].p2);
+		accumulator s, t;
+		closestPoints(a0, a1, b0, b1, s, t);
+		accumulatorVec3 vec = (a0 + s * (a1 - a0)) - (b0 + t * (b1 - b0));
+		accumulator distance = glm::length(vec);
+		accumulator radiusSum = radii[i] + radii[j];
+		if (distance >= radiusSum || distance == accumulator(0))
+			return;
+
+		accumulator weightSum = inverseMasses1[i] * (1 - s) * (1 - s) + inverseMasses2[i] * s * s
+			+ inverseMasses1[j] * (1 - t) * (1 - t) + inverseMasses2[j] * t * t;
+		if (weightSum == accumulator(0))
+			return;
+		accumulatorVec3 lambda = (radiusSum - distance) / (weightSum * distance) * vec;
+		correction1 += inverseMasses1[i] * (1 - s) * lambda;
+		correction2 += inverseMasses2[i] * s * lambda;
+		contacts++;
+	}
+
+public:
+	//Starts collecting the segments of this step
+	void clear() {
+		segments.clear();
+	}
+
+	//Adds the constraints of an object, whose particle indices are relative to firstParticle
+	template <typename Index>
+	void addSegments(ParticleStoreT<P> & particles, int firstParticle, std::vector<ConstraintT<P, Index> > & constraints) {
+		for (ConstraintT<P, Index> & constraint : constraints) {
+			Segment segment = { firstParticle + constraint.getP1(), firstParticle + constraint.getP2() };
+			if (glm::max(particles.radii[segment.p1], particles.radii[segment.p2]) > 0)
+				segments.push_back(segment);
+		}
+	}
+
+	//Pushes all overlapping segments of the collected ones apart:
+	void solve(ParticleStoreT<P> & particles) {
+		int n = (int)segments.size();
+		numberOfContacts = 0;
+		if (n < 2)
+			return;
+
+		radii.resize(n);
+		inverseMasses1.resize(n);
+		inverseMasses2.resize(n);
+		groups.resize(n);
+		for (int s = 0; s < n; s++) {
+			int p1 = segments[s].p1, p2 = segments[s].p2;
+			radii[s] = glm::max(particles.radii[p1], particles.radii[p2]);
+			inverseMasses1[s] = particles.isMovables[p1] ? accumulator(1) / particles.masses[p1] : accumulator(0);
+			inverseMasses2[s] = particles.isMovables[p2] ? accumulator(1) / particles.masses[p2] : accumulator(0);
+			groups[s] = particles.groups[p1];
+		}
+
+		if (!isBuiltFor()) {
+			std::vector<int> order(n);
+			for (int s = 0; s < n; s++)
+				order[s] = s;
+			nodes.clear();
+			build(particles, order, 0, n);
+			builtSegments = segments;
+		}
+		refit(particles);
+
+		segmentCorrections.resize(2 * n);
+		segmentContacts.resize(n);
+		int contacts = 0;
+		#pragma omp parallel for reduction(+:contacts) if (n > 256)
+		for (int i = 0; i < n; i++) {
+			accumulatorVec3 correction1 = accumulatorVec3(0, 0, 0), correction2 = accumulatorVec3(0, 0, 0);
+			int ownContacts = 0;
+
+			//the bounds of the leaf of segment i are its query box
+			accumulatorVec3 a = position(particles, segments[i].p1), b = position(particles, segments[i].p2);
+			accumulatorVec3 queryLower = glm::min(a, b) - accumulatorVec3(radii[i]);
+			accumulatorVec3 queryUpper = glm::max(a, b) + accumulatorVec3(radii[i]);
+
+			int stack[64];
+			int stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0) {
+				const Node & node = nodes[stack[--stackSize]];
+				if (glm::any(glm::lessThan(node.upper, queryLower)) || glm::any(glm::greaterThan(node.lower, queryUpper)))
+					continue;
+				if (node.segment >= 0) {
+					if (groups[node.segment] != groups[i])
+						collide(particles, i, node.segment, correction1, correction2, ownContacts);
+				}
+				else {
+					stack[stackSize++] = node.left;
+					stack[stackSize++] = node.right;
+				}
+			}
+
+			segmentCorrections[2 * i] = correction1;
+			segmentCorrections[2 * i + 1] = correction2;
+			segmentContacts[i] = ownContacts;
+			contacts += ownContacts;
+		}
+
+		//particles inside a rope belong to two segments, their corrections are averaged
+		particleCorrections.resize(particles.size());
+		particleContacts.resize(particles.size());
+		for (int s = 0; s < n; s++) {
+			particleCorrections[segments[s].p1] = particleCorrections[segments[s].p2] = accumulatorVec3(0, 0, 0);
+			particleContacts[segments[s].p1] = particleContacts[segments[s].p2] = 0;
+		}
+		for (int s = 0; s < n; s++) {
+			if (segmentContacts[s] == 0)
+				continue;
+			particleCorrections[segments[s].p1] += segmentCorrections[2 * s];
+			particleCorrections[segments[s].p2] += segmentCorrections[2 * s + 1];
+			particleContacts[segments[s].p1] += segmentContacts[s];
+			particleContacts[segments[s].p2] += segmentContacts[s];
+		}
+		for (int s = 0; s < n; s++) {
+			for (int p : { segments[s].p1, segments[s].p2 }) {
+				if (particleContacts[p] > 0) {
+					particles.positions[p] = vec3(position(particles, p) + particleCorrections[p] / accumulator(particleContacts[p]));
+					particleContacts[p] = 0;
+				}
+			}
+		}
+		numberOfContacts = contacts / 2;
+	}
+
+	//overlapping pairs of segments found in the last step
+	int getNumberOfContacts() {
+		return numberOfContacts;
+	}
+};
+
+typedef SegmentCollisionT<WorldPrecision> SegmentCollision;
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Constraint.h"
+
+// Shape matching (meshless deformation) of a group of particles: the rest shape is rotated and translated to best
+// fit the current positions and the particles are moved towards it, which restores the whole group in one closed
+// form pass instead of relaxing a web of distance constraints. The rotation is the rotational part of
+//   A = sum m_i (x_i - c)(q_i)^T
+// with q_i the rest offsets from the rest center of mass. It is extracted as a quaternion following Mueller et al.
+// 2016, "A Robust Method to Extract the Rotational Part of Deformations", warm started with the rotation of the
+// last pass. Unlike a polar decomposition of A this also works for flat groups like the body of the character.
+template <typename P>
+class ShapeMatchingConstraintT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+	typedef glm::mat<3, 3, accumulator> accumulatorMat3;
+	typedef glm::qua<accumulator> accumulatorQuat;
+
+	std::vector<ConstraintIndex> particleIndices; // relative to the base index given when solving
+	std::vector<accumulatorVec3> restOffsets;
+	accumulator stiffness; // 1 restores the rest shape completely in one pass
+	accumulatorQuat rotation = accumulatorQuat(1, 0, 0, 0);
+	int rotationIterations = 4;
+
+	accumulatorVec3 centerOfMass(const std::vector<vec3> & positions, const std::vector<scalar> & masses, int base) {
+		accumulatorVec3 center = accumulatorVec3(0, 0, 0);
+		accumulator totalMass = 0;
+		for (ConstraintIndex i : particleIndices) {
+			center += accumulator(masses[base + i]) * accumulatorVec3(positions[base + i]);
+			totalMass += masses[base + i];
+		}
+		return center / totalMass;
+	}
+
+	void extractRotation(const accumulatorMat3 & A) {
+		for (int k = 0; k < rotationIterations; k++) {
+			accumulatorMat3 R = glm::mat3_cast(rotation);
+			accumulatorVec3 omega = (glm::cross(R[0], A[0]) + glm::cross(R[1], A[1]) + glm::cross(R[2], A[2]))
+				/ (glm::abs(glm::dot(R[0], A[0]) + glm::dot(R[1], A[1]) + glm::dot(R[2], A[2])) + accumulator(1.0e-9));
+			accumulator angle = glm::length(omega);
+			if (angle < accumulator(1.0e-9))
+				break;
+			rotation = glm::normalize(glm::angleAxis(angle, omega / angle) * rotation);
+		}
+	}
+
+public:
+	//The current positions of the particles are their rest shape:
+	ShapeMatchingConstraintT(const std::vector<int> & particles, const std::vector<vec3> & positions, const std::vector<scalar> & masses, int base, scalar stiffness) {
+		for (int i : particles)
+			particleIndices.push_back(ConstraintIndex(i));
+		this->stiffness = stiffness;
+
+		accumulatorVec3 center = centerOfMass(positions, masses, base);
+		for (ConstraintIndex i : particleIndices)
+			restOffsets.push_back(accumulatorVec3(positions[base + i]) - center);
+	}
+
+	//Moves the particles towards the matched rest shape and returns the largest distance of a particle to its goal
+	accumulator solve(std::vector<vec3> & positions, const std::vector<scalar> & masses, const std::vector<bool> & isMovables, int base) {
+		accumulatorVec3 center = centerOfMass(positions, masses, base);
+
+		accumulatorMat3 A = accumulatorMat3(0);
+		for (int k = 0; k < (int)particleIndices.size(); k++) {
+			int i = base + particleIndices[k];
+			A += accumulator(masses[i]) * glm::outerProduct(accumulatorVec3(positions[i]) - center, restOffsets[k]);
+		}
+		extractRotation(A);
+		accumulatorMat3 R = glm::mat3_cast(rotation);
+
+		accumulator maxResidual = 0;
+		for (int k = 0; k < (int)particleIndices.size(); k++) {
+			int i = base + particleIndices[k];
+			accumulatorVec3 goal = center + R * restOffsets[k];
+			accumulatorVec3 difference = goal - accumulatorVec3(positions[i]);
+			maxResidual = glm::max(maxResidual, glm::length(difference));
+			if (isMovables[i])
+				positions[i] = vec3(accumulatorVec3(positions[i]) + stiffness * difference);
+		}
+		return maxResidual;
+	}
+
+	//Forget the rotation of the last pass, for when the particles were reset
+	void resetRotation() {
+		rotation = accumulatorQuat(1, 0, 0, 0);
+	}
+
+	int getNumberOfParticles() {
+		return (int)particleIndices.size();
+	}
+};
+
+typedef ShapeMatchingConstraintT<WorldPrecision> ShapeMatchingConstraint;
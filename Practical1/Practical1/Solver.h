@@ -4,99 +4,287 @@
 #include <glm/glm.hpp>
 
 #include "Constraint.h"
+#include "ParticleStore.h"
+#include "ChainSolver.h"
+#include "Integrators.h"
+#include "ChebyshevAccelerator.h"
+#include "ShapeMatchingConstraint.h"
+#include "ProjectiveDynamics.h"
+#include "ImplicitEuler.h"
+#include "Collider.h"
+#include "VerletList.h"
+#include "PerfCounters.h"
 
-enum IntegrationScheme { verlet };
+enum ConstraintSolveMode { iterativeConstraints, directChain, unrolledTopology, projectiveDynamics };
 
-class Solver {
+template <typename P>
+class SolverT {
 private:
-	std::vector<vec3> & positions;
-	std::vector<vec3> & oldPositions;
-	std::vector<vec3> & velocities;
-	std::vector<vec3> & accelerations;
-	std::vector<SCALAR> & masses;
-	std::vector<bool> & isMovables;
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
 
-	std::vector<Constraint> & constraints;
+	ParticleStoreT<P> & particles;
+	int firstParticle, numberOfParticles; // the range of the store owned by this solver
 
-	std::vector<Collider*> colliders;
+	std::vector<ConstraintT<P, ConstraintIndex> > & constraints; // relative to firstParticle
+	std::vector<ConstraintT<P> > & connectors; // global indices
+	std::vector<ConstraintT<P, ConstraintIndex> > * longRangeAttachments = NULL; // max distance constraints, relative to firstParticle
+	std::vector<ShapeMatchingConstraintT<P> > * shapeMatchingConstraints = NULL; // relative to firstParticle
+	int firstActiveConstraint = 0; // the constraints before are covered by the shape matching constraints and skipped
 
-	bool firstTimeStep = true;
+	std::vector<ColliderT<P>*> colliders;
+	std::vector<std::vector<int> > colliderCandidates; // per collider the particles within its skin
+	std::vector<scalar> colliderDistances;
+	std::vector<int> ownParticles; // global indices, what the collider list is checked for
+	VerletListT<P> colliderList = VerletListT<P>(0);
+
+	PhaseProfiler * profiler = NULL;
+
+	typedef void (*IntegrationKernel)(ParticleStoreT<P> &, int, int, accumulator, accumulator, accumulator);
+	typedef void (*VelocityKernel)(ParticleStoreT<P> &, int, int, accumulator);
+	typedef void (*ConstraintKernel)(ParticleStoreT<P> &, int, std::vector<ConstraintT<P, ConstraintIndex> > &, accumulator &, accumulator &);
+
+	scalar lastTimeStepSize = 0;
 	IntegrationScheme integrationScheme;
+	IntegrationKernel integrationKernel; // selected once per scheme, so stepping does not branch on it
+	VelocityKernel velocityKernel;
+	ConstraintSolveMode constraintSolveMode = iterativeConstraints;
+	ChainSolverT<P> chainSolver;
+	ConstraintKernel unrolledConstraintKernel = NULL; // pass of an UnrolledConstraintSolverT for the topology of the object
+	ProjectiveDynamicsSolverT<P> projectiveDynamicsSolver;
+	scalar projectiveDynamicsWeight = scalar(1.0e5); // stiffness of every constraint in the projective dynamics energy
+	ImplicitEulerSolverT<P> implicitEulerSolver;
+	scalar springStiffness = 0; // of every constraint when integrated implicitly, see setSpringStiffness
+	scalar springDamping = 0;
+	ChebyshevAcceleratorT<P> chebyshev = ChebyshevAcceleratorT<P>(scalar(0.9), 3);
+	bool chebyshevEnabled = false; // not used with directChain
 
 	int constraintIterations;
-	SCALAR dragConstant;
+	scalar constraintTolerance = 0; // iterations stop once the largest violation is below this, 0 always runs all
+	scalar dragConstant = 0; // damping of this object per second, added to the global drag of the world
+
+	//residual statistics of the current time step, measured while projecting
+	accumulator maxResidual = 0;
+	accumulator squaredResidualSum = 0;
+	int numberOfResiduals = 0;
+	int iterations = 0;
+
+	inline void addResidual(accumulator residual) {
+		maxResidual = glm::max(maxResidual, residual);
+		squaredResidualSum += residual * residual;
+	}
 
 public:
-	Solver(IntegrationScheme integrationScheme,
-		std::vector<vec3> & positions,
-		std::vector<vec3> & oldPositions,
-		std::vector<vec3> & velocities,
-		std::vector<vec3> & accelerations,
-		std::vector<SCALAR> & masses,
-		std::vector<bool> & isMovables,
-		std::vector<Constraint> & constraints) :
-		positions(positions),
-		oldPositions(oldPositions),
-		velocities(velocities),
-		accelerations(accelerations),
-		masses(masses),
-		isMovables(isMovables),
-		constraints(constraints) {
+	SolverT(IntegrationScheme integrationScheme,
+		ParticleStoreT<P> & particles,
+		int firstParticle,
+		int numberOfParticles,
+		std::vector<ConstraintT<P, ConstraintIndex> > & constraints,
+		std::vector<ConstraintT<P> > & connectors) :
+		particles(particles),
+		constraints(constraints),
+		connectors(connectors) {
 
-		this->integrationScheme = integrationScheme;
+		setIntegrationScheme(integrationScheme);
+		this->firstParticle = firstParticle;
+		this->numberOfParticles = numberOfParticles;
+		for (int i = firstParticle; i < firstParticle + numberOfParticles; i++)
+			ownParticles.push_back(i);
 	}
 
-	void evaluateVerlet(SCALAR timeStepSize, bool dragEnabled) {
-		if (firstTimeStep) {
-			//Integration:
-			for (int i = 0; i < positions.size(); i++) {
-				if (isMovables[i]) {
-					velocities[i] = velocities[i] + accelerations[i] * timeStepSize;
-					positions[i] = positions[i] + velocities[i] * timeStepSize;
-					accelerations[i] = vec3(0, 0, 0);
-				}
+	//Advances all particles of this solver one time step, the constraint and collision phases follow separately.
+	//Drag removes the share (globalDragConstant + dragConstant) * timeStepSize of the velocity and is folded into the
+	//factor the velocity or the Verlet displacement is scaled with anyway.
+	void integrate(scalar timeStepSize, bool dragEnabled, scalar globalDragConstant = 0) {
+		if (isAccelerated())
+			chebyshev.endStep(iterations);
+
+		accumulator damping = 1;
+		if (dragEnabled)
+			damping = glm::max(accumulator(0), accumulator(1) - (accumulator(globalDragConstant) + dragConstant) * timeStepSize);
+		accumulator timeStepRatio = lastTimeStepSize > 0 ? accumulator(timeStepSize) / lastTimeStepSize : 1;
+
+		if (integrationScheme == implicitEuler)
+			implicitEulerSolver.step(particles, firstParticle, numberOfParticles, constraints, accumulator(timeStepSize), damping, springStiffness, springDamping);
+		else
+			integrationKernel(particles, firstParticle, firstParticle + numberOfParticles, accumulator(timeStepSize), timeStepRatio, damping);
+
+		lastTimeStepSize = timeStepSize;
+		iterations = 0;
+
+		if (constraintSolveMode == projectiveDynamics)
+			projectiveDynamicsSolver.beginStep(particles, firstParticle, numberOfParticles, constraints, connectors, timeStepSize, projectiveDynamicsWeight);
+
+		if (isAccelerated())
+			chebyshev.beginStep(particles, firstParticle, numberOfParticles);
+	}
+
+	//One pass over the constraints inside the object. The residual is the violation found during this pass.
+	//Projective dynamics always works on all constraints and leaves out the shape matching constraints. With implicit
+	//integration the constraints already acted as springs, they are only measured here.
+	void solveConstraints() {
+		maxResidual = 0;
+		squaredResidualSum = 0;
+		numberOfResiduals = (int)constraints.size() - firstActiveConstraint;
+
+		if (shapeMatchingConstraints && constraintSolveMode != projectiveDynamics) {
+			for (ShapeMatchingConstraintT<P> & shape : *shapeMatchingConstraints) {
+				addResidual(shape.solve(particles.positions, particles.masses, particles.isMovables, firstParticle));
 			}
-			firstTimeStep = false;
+			numberOfResiduals += (int)shapeMatchingConstraints->size();
 		}
 
+		if (integrationScheme == implicitEuler) {
+			for (int j = firstActiveConstraint; j < (int)constraints.size(); j++) {
+				addResidual(constraints[j].getViolation(particles.positions, firstParticle));
+			}
+		}
+		else if (constraintSolveMode == projectiveDynamics) {
+			numberOfResiduals = (int)constraints.size();
+			projectiveDynamicsSolver.iterate(particles, firstParticle, numberOfParticles, constraints, connectors, projectiveDynamicsWeight, maxResidual, squaredResidualSum);
+		}
+		else if (constraintSolveMode == directChain) {
+			chainSolver.solve(particles, firstParticle, constraints, maxResidual, squaredResidualSum);
+		}
+		else if (constraintSolveMode == unrolledTopology) {
+			unrolledConstraintKernel(particles, firstParticle, constraints, maxResidual, squaredResidualSum);
+		}
 		else {
-			//Integration:
-			for (int i = 0; i < positions.size(); i++) {
-				if (isMovables[i]) {
-					if (dragEnabled) {
-					}
-					vec3 temp = positions[i];
-					positions[i] = positions[i] + positions[i] - oldPositions[i] + accelerations[i] * pow(timeStepSize, 2);
-					oldPositions[i] = temp;
-					accelerations[i] = vec3(0, 0, 0);
-				}
+			for (int j = firstActiveConstraint; j < (int)constraints.size(); j++) {
+				addResidual(constraints[j].solveConstraint(particles.positions, particles.isMovables, firstParticle));
 			}
 		}
 
-		//Constraint solving
-		for (int i = 0; i < constraintIterations; i++) {
-			for (Constraint constraint : constraints) {
-				constraint.solveConstraints();
+		if (longRangeAttachments) {
+			for (ConstraintT<P, ConstraintIndex> & attachment : *longRangeAttachments) {
+				addResidual(attachment.solveMaxDistance(particles.positions, particles.isMovables, firstParticle));
 			}
+			numberOfResiduals += (int)longRangeAttachments->size();
 		}
+		iterations++;
 
-		//Collision detection
-		for (vec3 & position : positions) {
-			for (Collider* collider : colliders) {
+		if (isAccelerated())
+			chebyshev.accelerate(particles, firstParticle, iterations, maxResidual);
+	}
+
+	//One pass over the connectors to other objects. Returns the largest connector violation.
+	accumulator solveConnectors() {
+		accumulator maxConnectorResidual = 0;
+		for (ConstraintT<P> & connector : connectors) {
+			maxConnectorResidual = glm::max(maxConnectorResidual, connector.solveConstraint(particles.positions, particles.isMovables, 0));
+		}
+		return maxConnectorResidual;
+	}
+
+	bool isAccelerated() {
+		return chebyshevEnabled && constraintSolveMode != directChain && integrationScheme != implicitEuler;
+	}
+
+	std::vector<ConstraintT<P> > & getConnectors() {
+		return connectors;
+	}
+
+	//An implicitly integrated object gains nothing from more passes, its springs settle over the next steps
+	bool isConverged() {
+		return maxResidual < constraintTolerance || integrationScheme == implicitEuler;
+	}
+
+	//Largest speed of the movable particles after the last step:
+	scalar getMaxSpeed() {
+		accumulator maxSpeed = 0;
+		int lastParticle = firstParticle + numberOfParticles;
+		for (int i = firstParticle; i < lastParticle; i++) {
+			if (particles.isMovables[i])
+				maxSpeed = glm::max(maxSpeed, accumulator(glm::length(particles.velocities[i])));
+		}
+		return scalar(maxSpeed);
+	}
+
+	//Smallest length a particle must not skip over in one step: the shortest constraint or the thinnest active collider
+	scalar getSmallestFeatureSize() {
+		scalar featureSize = std::numeric_limits<scalar>::max();
+		for (ConstraintT<P, ConstraintIndex> & constraint : constraints) {
+			if (constraint.getRestDistance() > 0)
+				featureSize = glm::min(featureSize, constraint.getRestDistance());
+		}
+		for (ColliderT<P>* collider : colliders) {
+			if (collider->isActive())
+				featureSize = glm::min(featureSize, collider->getThickness());
+		}
+		return featureSize;
+	}
+
+	//Every collider handles all of its particles at once, so colliders with an acceleration structure can query
+	//them together. With a skin the pairs of particles and colliders closer than it are kept in a Verlet list and
+	//only they are tested. Each particle meets the colliders in the same order either way.
+	void handleCollisions() {
+		if (colliderList.getSkin() <= 0) {
+			for (ColliderT<P>* collider : colliders) {
 				if (collider->isActive())
-					collider->handleCollision(position);
+					collider->handleCollisions(particles.positions, ownParticles);
 			}
+			return;
 		}
 
-		//Velocity correction:
-		for (int i = 0; i < positions.size(); i++) {
-			if (isMovables[i]) {
-				velocities[i] = (positions[i] - oldPositions[i]) / timeStepSize;
+		if (colliderList.needsRebuild(particles.positions, ownParticles)) {
+			colliderCandidates.resize(colliders.size());
+			for (int c = 0; c < (int)colliders.size(); c++) {
+				colliders[c]->getDistances(particles.positions, ownParticles, colliderDistances);
+				colliderCandidates[c].clear();
+				for (int k = 0; k < (int)ownParticles.size(); k++) {
+					if (colliderDistances[k] < colliderList.getSkin())
+						colliderCandidates[c].push_back(ownParticles[k]);
+				}
 			}
 		}
+		for (int c = 0; c < (int)colliders.size(); c++) {
+			if (colliders[c]->isActive() && !colliderCandidates[c].empty())
+				colliders[c]->handleCollisions(particles.positions, colliderCandidates[c]);
+		}
+	}
+
+	void updateVelocities(scalar timeStepSize) {
+		//Velocity correction:
+		velocityKernel(particles, firstParticle, firstParticle + numberOfParticles, accumulator(timeStepSize));
+	}
+
+	//Runs all phases for this object alone. Objects that are coupled to others are stepped through the World instead.
+	void evaluateVerlet(scalar timeStepSize, bool dragEnabled) {
+		if (profiler)
+			profiler->begin(integrationPhase);
+
+		integrate(timeStepSize, dragEnabled);
+
+		if (profiler) {
+			profiler->end(integrationPhase);
+			profiler->begin(constraintPhase);
+		}
+
+		//Constraint solving
+		for (int i = 0; i < constraintIterations; i++) {
+			solveConstraints();
+			accumulator connectorResidual = solveConnectors();
+			if (isConverged() && connectorResidual < constraintTolerance)
+				break;
+		}
+
+		if (profiler) {
+			profiler->end(constraintPhase);
+			profiler->begin(collisionPhase);
+		}
+
+		//Collision detection
+		handleCollisions();
+
+		if (profiler)
+			profiler->end(collisionPhase);
+
+		updateVelocities(timeStepSize);
 	}
 
-	void setDragConstant(int dragConstant) {
+	void setDragConstant(scalar dragConstant) {
 		this->dragConstant = dragConstant;
 	}
 
@@ -104,15 +292,120 @@ public:
 		this->constraintIterations = constraintIterations;
 	}
 
+	//The direct solver is only available if the constraints form a chain, the unrolled one if the object provided a
+	//kernel for its topology. Returns the mode actually used.
+	ConstraintSolveMode setConstraintSolveMode(ConstraintSolveMode constraintSolveMode) {
+		if (constraintSolveMode == directChain && !ChainSolverT<P>::isChain(constraints))
+			constraintSolveMode = iterativeConstraints;
+		if (constraintSolveMode == unrolledTopology && !unrolledConstraintKernel)
+			constraintSolveMode = iterativeConstraints;
+		this->constraintSolveMode = constraintSolveMode;
+		return constraintSolveMode;
+	}
+
+	void setConstraintTolerance(scalar constraintTolerance) {
+		this->constraintTolerance = constraintTolerance;
+	}
+
+	scalar getMaxResidual() {
+		return scalar(maxResidual);
+	}
+
+	scalar getRmsResidual() {
+		return numberOfResiduals > 0 ? scalar(glm::sqrt(squaredResidualSum / numberOfResiduals)) : scalar(0);
+	}
+
+	//constraint passes of the last time step
+	int getIterations() {
+		return iterations;
+	}
+
+	void setChebyshevAcceleration(bool enabled, scalar spectralRadius, int warmUpIterations) {
+		chebyshevEnabled = enabled;
+		chebyshev = ChebyshevAcceleratorT<P>(spectralRadius, warmUpIterations);
+	}
+
+	//Shape matching replaces the constraints [0, firstActiveConstraint), the direct chain solve always uses all of them
+	void setShapeMatching(std::vector<ShapeMatchingConstraintT<P> > * shapeMatchingConstraints, int firstActiveConstraint) {
+		this->shapeMatchingConstraints = shapeMatchingConstraints;
+		this->firstActiveConstraint = shapeMatchingConstraints ? firstActiveConstraint : 0;
+	}
+
+	void setProjectiveDynamicsWeight(scalar projectiveDynamicsWeight) {
+		this->projectiveDynamicsWeight = projectiveDynamicsWeight;
+	}
+
+	//Spring constants of the constraints for implicitEuler: force per unit stretch and per unit stretching speed
+	void setSpringStiffness(scalar springStiffness, scalar springDamping) {
+		this->springStiffness = springStiffness;
+		this->springDamping = springDamping;
+	}
+
+	//conjugate gradient iterations of the last implicit step
+	int getImplicitIterations() {
+		return implicitEulerSolver.getLastIterations();
+	}
+
+	void setUnrolledConstraintKernel(ConstraintKernel unrolledConstraintKernel) {
+		this->unrolledConstraintKernel = unrolledConstraintKernel;
+	}
+
+	ChebyshevAcceleratorT<P> & getChebyshevAccelerator() {
+		return chebyshev;
+	}
+
+	void setLongRangeAttachments(std::vector<ConstraintT<P, ConstraintIndex> > * longRangeAttachments) {
+		this->longRangeAttachments = longRangeAttachments;
+	}
+
 	void setIntegrationScheme(IntegrationScheme integrationScheme) {
 		this->integrationScheme = integrationScheme;
+		switch (integrationScheme) {
+		case symplecticEuler:
+			integrationKernel = &SymplecticEulerIntegrator<P>::integrate;
+			velocityKernel = &SymplecticEulerIntegrator<P>::updateVelocities;
+			break;
+		case velocityVerlet:
+			integrationKernel = &VelocityVerletIntegrator<P>::integrate;
+			velocityKernel = &VelocityVerletIntegrator<P>::updateVelocities;
+			break;
+		case positionVerlet:
+			integrationKernel = &PositionVerletIntegrator<P>::integrate;
+			velocityKernel = &PositionVerletIntegrator<P>::updateVelocities;
+			break;
+		case implicitEuler:
+			integrationKernel = NULL;
+			velocityKernel = &updateVelocitiesFromPositions<P>;
+			break;
+		}
 	}
 
+	IntegrationScheme getIntegrationScheme() {
+		return integrationScheme;
+	}
+
+	//Forgets the last step size, for when the object was reset to rest (oldPositions equal to positions)
 	void setToFirstTimeStep() {
-		firstTimeStep = true;
+		lastTimeStepSize = 0;
 	}
 
-	void setColliders(std::vector<Collider*> colliders) {
+	void setColliders(std::vector<ColliderT<P>*> colliders) {
 		this->colliders = colliders;
+		colliderList.invalidate();
+	}
+
+	//0 tests every particle against every collider each step
+	void setColliderSkin(scalar skin) {
+		colliderList.setSkin(skin);
+	}
+
+	VerletListT<P> & getColliderList() {
+		return colliderList;
 	}
-};
\ No newline at end of file
+
+	void setProfiler(PhaseProfiler * profiler) {
+		this->profiler = profiler;
+	}
+};
+
+typedef SolverT<WorldPrecision> Solver;
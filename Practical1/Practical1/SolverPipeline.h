@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Constraint.h"
+#include "ParticleStore.h"
+#include "ChainSolver.h"
+#include "Integrators.h"
+#include "PlaneCollider.h"
+#include "AABBCollider.h"
+
+// Statically composed counterpart of Solver for objects whose configuration is fixed: the integrator, the
+// constraint solver and the collision handling are template policies, so a step compiles into straight loops
+// without virtual collider calls, kernel pointers or mode switches. Residuals, acceleration and connectors are
+// left out, a pipeline steps its object on its own like Solver::evaluateVerlet.
+
+// Gauss-Seidel passes over the distance constraints.
+template <typename P>
+struct IterativeConstraintPolicy {
+	template <typename Index>
+	inline void solve(ParticleStoreT<P> & particles, int base, std::vector<ConstraintT<P, Index> > & constraints) {
+		for (ConstraintT<P, Index> & constraint : constraints) {
+			constraint.solveConstraint(particles.positions, particles.isMovables, base);
+		}
+	}
+};
+
+// Direct tridiagonal solve, the constraints must form a chain.
+template <typename P>
+struct DirectChainPolicy {
+	ChainSolverT<P> chainSolver;
+
+	template <typename Index>
+	inline void solve(ParticleStoreT<P> & particles, int base, std::vector<ConstraintT<P, Index> > & constraints) {
+		typename P::accumulator maxResidual = 0, squaredResidualSum = 0;
+		chainSolver.solve(particles, base, constraints, maxResidual, squaredResidualSum);
+	}
+};
+
+template <typename P>
+struct NoCollisionPolicy {
+	inline void handleCollisions(ParticleStoreT<P> &, int, int) {}
+};
+
+// Planes and boxes held by their concrete types, so the collision calls are resolved at compile time.
+template <typename P>
+struct StaticColliderPolicy {
+	std::vector<PlaneColliderT<P>*> planes;
+	std::vector<AABBColliderT<P>*> boxes;
+
+	inline void handleCollisions(ParticleStoreT<P> & particles, int firstParticle, int lastParticle) {
+		for (int i = firstParticle; i < lastParticle; i++) {
+			for (PlaneColliderT<P>* plane : planes) {
+				if (plane->isActive())
+					plane->PlaneColliderT<P>::handleCollision(particles.positions[i]);
+			}
+			for (AABBColliderT<P>* box : boxes) {
+				if (box->isActive())
+					box->AABBColliderT<P>::handleCollision(particles.positions[i]);
+			}
+		}
+	}
+};
+
+template <typename P,
+	template <typename> class Integrator,
+	template <typename> class ConstraintPolicy,
+	template <typename> class CollisionPolicy>
+class SolverPipelineT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	ParticleStoreT<P> & particles;
+	int firstParticle, numberOfParticles;
+	std::vector<ConstraintT<P, ConstraintIndex> > & constraints; // relative to firstParticle
+
+	ConstraintPolicy<P> constraintPolicy;
+	CollisionPolicy<P> collisionPolicy;
+
+	scalar lastTimeStepSize = 0;
+	int constraintIterations = 1;
+	scalar dragConstant = 0;
+
+public:
+	SolverPipelineT(ParticleStoreT<P> & particles, int firstParticle, int numberOfParticles,
+		std::vector<ConstraintT<P, ConstraintIndex> > & constraints) :
+		particles(particles),
+		constraints(constraints) {
+
+		this->firstParticle = firstParticle;
+		this->numberOfParticles = numberOfParticles;
+	}
+
+	//Integration, constraint passes, collisions and velocity update of one time step:
+	void step(scalar timeStepSize, bool dragEnabled) {
+		int lastParticle = firstParticle + numberOfParticles;
+
+		accumulator damping = 1;
+		if (dragEnabled)
+			damping = glm::max(accumulator(0), accumulator(1) - accumulator(dragConstant) * timeStepSize);
+		accumulator timeStepRatio = lastTimeStepSize > 0 ? accumulator(timeStepSize) / lastTimeStepSize : 1;
+		Integrator<P>::integrate(particles, firstParticle, lastParticle, accumulator(timeStepSize), timeStepRatio, damping);
+		lastTimeStepSize = timeStepSize;
+
+		for (int i = 0; i < constraintIterations; i++) {
+			constraintPolicy.solve(particles, firstParticle, constraints);
+		}
+
+		collisionPolicy.handleCollisions(particles, firstParticle, lastParticle);
+
+		Integrator<P>::updateVelocities(particles, firstParticle, lastParticle, accumulator(timeStepSize));
+	}
+
+	CollisionPolicy<P> & getCollisionPolicy() {
+		return collisionPolicy;
+	}
+
+	void setConstraintIterations(int constraintIterations) {
+		this->constraintIterations = constraintIterations;
+	}
+
+	void setDragConstant(scalar dragConstant) {
+		this->dragConstant = dragConstant;
+	}
+};
+
+// The configurations of the game objects: ropes are Verlet chains without colliders, the character is integrated
+// with symplectic Euler, relaxed iteratively and collides with the level.
+template <typename P>
+using RopePipelineT = SolverPipelineT<P, PositionVerletIntegrator, DirectChainPolicy, NoCollisionPolicy>;
+
+template <typename P>
+using CharacterPipelineT = SolverPipelineT<P, SymplecticEulerIntegrator, IterativeConstraintPolicy, StaticColliderPolicy>;
+
+typedef RopePipelineT<WorldPrecision> RopePipeline;
+typedef CharacterPipelineT<WorldPrecision> CharacterPipeline;
@@ -0,0 +1,621 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <limits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "Collider.h"
+#include "MeshRenderer.h"
+
+// Static level geometry given as a closed triangle mesh with its triangles facing outwards, e.g. imported from an
+// OBJ file. A particle is inside if it lies behind its closest point on the mesh, judged by the angle weighted
+// pseudo normal of the vertex, edge or face the closest point lies on, and is then moved onto that point.
+// The closest triangles are found in a bounding volume hierarchy built with the surface area heuristic and
+// collapsed to 4 children per node. A node keeps the boxes of its children side by side per coordinate, so a query
+// tests all four in one loop the compiler can vectorize, and the nodes are stored depth first in one array. All
+// particles of an object traverse the hierarchy together: a node is visited once for the particles that can still
+// have their closest triangle below it instead of once per particle.
+template <typename P>
+class TriangleMeshColliderT : public ColliderT<P> {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	static const int BINS = 12;
+	static const int LEAF_SIZE = 4; // triangles below which a node is not split
+	static const int MAX_LEAF_SIZE = 16; // triangles above which a node is split even if the heuristic disagrees
+
+	struct Triangle {
+		accumulatorVec3 corners[3];
+		//angle weighted pseudo normals of the features closestPoint tells apart: corners, edges 01 12 20, face
+		accumulatorVec3 normals[7];
+	};
+
+	struct Node {
+		scalar lowerX[4], lowerY[4], lowerZ[4];
+		scalar upperX[4], upperY[4], upperZ[4];
+		int first[4]; // inner children: their node, leaves: their first triangle
+		int count[4]; // leaves: their number of triangles, 0 for inner children, -1 for empty slots
+	};
+
+	struct BuildNode {
+		accumulatorVec3 lower, upper;
+		int left, right; // -1 for leaves
+		int first, count; // triangles of leaves in the build order
+	};
+
+	struct Query {
+		accumulatorVec3 position; // relative to the mesh
+		accumulator squaredDistance; // to the closest point found so far
+		accumulatorVec3 closestPoint;
+		accumulatorVec3 normal; // pseudo normal at the closest point
+	};
+
+	//queries of a node on the traversal stack, the range [first, first + count) of active
+	struct Packet {
+		int node;
+		int first, count;
+	};
+
+	std::vector<Triangle> triangles; // in the order of the leaves
+	std::vector<Node> nodes; // the root is nodes[0]
+	accumulatorVec3 lower, upper; // of the whole mesh
+	accumulatorVec3 offset = accumulatorVec3(0, 0, 0); // from world to mesh positions, sum of the origin shifts
+	scalar thickness;
+
+	std::vector<Query> queries;
+	std::vector<int> queryParticles;
+	std::vector<int> active;
+	std::vector<Packet> packets;
+	std::vector<int> laneQueries[4];
+
+	static accumulator halfArea(const accumulatorVec3 & lower, const accumulatorVec3 & upper) {
+		accumulatorVec3 extent = glm::max(upper - lower, accumulatorVec3(0));
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+
+	static accumulator angle(const accumulatorVec3 & a, const accumulatorVec3 & b) {
+		return glm::acos(glm::clamp(glm::dot(glm::normalize(a), glm::normalize(b)), accumulator(-1), accumulator(1)));
+	}
+
+	//Closest point of the triangle to p and on which corner (0 to 2), edge (3 to 5) or the face (6) it lies,
+	//after Ericson, "Real-Time Collision Detection", 5.1.5
+	static accumulatorVec3 closestPoint(const accumulatorVec3 & p, const Triangle & triangle, int & feature) {
+		const accumulatorVec3 & a = triangle.corners[0], & b = triangle.corners[1], & c = triangle.corners[2];
+		accumulatorVec3 ab = b - a, ac = c - a, ap = p - a;
+		accumulator d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0 && d2 <= 0) {
+			feature = 0;
+			return a;
+		}
+		accumulatorVec3 bp = p - b;
+		accumulator d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0 && d4 <= d3) {
+			feature = 1;
+			return b;
+		}
+		accumulator vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+			feature = 3;
+			return a + d1 / (d1 - d3) * ab;
+		}
+		accumulatorVec3 cp = p - c;
+		accumulator d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0 && d5 <= d6) {
+			feature = 2;
+			return c;
+		}
+		accumulator vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+			feature = 5;
+			return a + d2 / (d2 - d6) * ac;
+		}
+		accumulator va = d3 * d6 - d5 * d4;
+		if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+			feature = 4;
+			return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+		}
+		accumulator denominator = accumulator(1) / (va + vb + vc);
+		feature = 6;
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	void setTriangles(const std::vector<vec3> & vertices, const std::vector<glm::ivec3> & indices, std::vector<Triangle> & source) {
+		std::vector<accumulatorVec3> vertexNormals(vertices.size(), accumulatorVec3(0, 0, 0));
+		std::map<std::pair<int, int>, accumulatorVec3> edgeNormals;
+		std::vector<glm::ivec3> kept;
+		thickness = std::numeric_limits<scalar>::max();
+		for (const glm::ivec3 & index : indices) {
+			accumulatorVec3 corners[3] = { accumulatorVec3(vertices[index[0]]), accumulatorVec3(vertices[index[1]]), accumulatorVec3(vertices[index[2]]) };
+			accumulatorVec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			if (glm::length(normal) == accumulator(0))
+				continue;
+			normal = glm::normalize(normal);
+			kept.push_back(index);
+			for (int k = 0; k < 3; k++) {
+				accumulatorVec3 next = corners[(k + 1) % 3], previous = corners[(k + 2) % 3];
+				vertexNormals[index[k]] += angle(next - corners[k], previous - corners[k]) * normal;
+				edgeNormals[std::make_pair(glm::min(index[k], index[(k + 1) % 3]), glm::max(index[k], index[(k + 1) % 3]))] += normal;
+				thickness = glm::min(thickness, scalar(glm::distance(corners[k], next)));
+			}
+		}
+
+		source.resize(kept.size());
+		for (int t = 0; t < (int)kept.size(); t++) {
+			const glm::ivec3 & index = kept[t];
+			Triangle & triangle = source[t];
+			for (int k = 0; k < 3; k++) {
+				triangle.corners[k] = accumulatorVec3(vertices[index[k]]);
+				triangle.normals[k] = vertexNormals[index[k]];
+				triangle.normals[3 + k] = edgeNormals[std::make_pair(glm::min(index[k], index[(k + 1) % 3]), glm::max(index[k], index[(k + 1) % 3]))];
+			}
+			triangle.normals[6] = glm::cross(triangle.corners[1] - triangle.corners[0], triangle.corners[2] - triangle.corners[0]);
+		}
+	}
+
+	int build(std::vector<BuildNode> & buildNodes, const std::vector<Triangle> & source, std::vector<int> & order,
+		const std::vector<accumulatorVec3> & centroids, int first, int last) {
+		BuildNode node;
+		node.lower = accumulatorVec3(std::numeric_limits<accumulator>::max());
+		node.upper = -node.lower;
+		accumulatorVec3 centroidLower = node.lower, centroidUpper = node.upper;
+		for (int k = first; k < last; k++) {
+			for (const accumulatorVec3 & corner : source[order[k]].corners) {
+				node.lower = glm::min(node.lower, corner);
+				node.upper = glm::max(node.upper, corner);
+			}
+			centroidLower = glm::min(centroidLower, centroids[order[k]]);
+			centroidUpper = glm::max(centroidUpper, centroids[order[k]]);
+		}
+		node.left = node.right = -1;
+		node.first = first;
+		node.count = last - first;
+		int index = (int)buildNodes.size();
+		buildNodes.push_back(node);
+		if (node.count <= LEAF_SIZE)
+			return index;
+
+		//binned surface area heuristic: a split costs one box test plus the triangles of each side weighted by the
+		//share of the area of its box, a leaf costs its triangles
+		accumulator nodeArea = glm::max(halfArea(node.lower, node.upper), std::numeric_limits<accumulator>::min());
+		accumulator bestCost = std::numeric_limits<accumulator>::max();
+		int bestAxis = -1, bestSplit = 0;
+		for (int axis = 0; axis < 3; axis++) {
+			accumulator extent = centroidUpper[axis] - centroidLower[axis];
+			if (extent <= 0)
+				continue;
+			int binCounts[BINS] = {};
+			accumulatorVec3 binLower[BINS], binUpper[BINS];
+			for (int b = 0; b < BINS; b++) {
+				binLower[b] = accumulatorVec3(std::numeric_limits<accumulator>::max());
+				binUpper[b] = -binLower[b];
+			}
+			for (int k = first; k < last; k++) {
+				int b = glm::min(int(BINS * (centroids[order[k]][axis] - centroidLower[axis]) / extent), BINS - 1);
+				binCounts[b]++;
+				for (const accumulatorVec3 & corner : source[order[k]].corners) {
+					binLower[b] = glm::min(binLower[b], corner);
+					binUpper[b] = glm::max(binUpper[b], corner);
+				}
+			}
+			//the right side of every split swept from the right, the left side from the left
+			accumulator rightAreas[BINS];
+			int rightCounts[BINS];
+			accumulatorVec3 sideLower = accumulatorVec3(std::numeric_limits<accumulator>::max()), sideUpper = -sideLower;
+			int sideCount = 0;
+			for (int b = BINS - 1; b > 0; b--) {
+				sideLower = glm::min(sideLower, binLower[b]);
+				sideUpper = glm::max(sideUpper, binUpper[b]);
+				sideCount += binCounts[b];
+				rightAreas[b] = halfArea(sideLower, sideUpper);
+				rightCounts[b] = sideCount;
+			}
+			sideLower = accumulatorVec3(std::numeric_limits<accumulator>::max());
+			sideUpper = -sideLower;
+			sideCount = 0;
+			for (int b = 1; b < BINS; b++) {
+				sideLower = glm::min(sideLower, binLower[b - 1]);
+				sideUpper = glm::max(sideUpper, binUpper[b - 1]);
+				sideCount += binCounts[b - 1];
+				if (sideCount == 0 || rightCounts[b] == 0)
+					continue;
+				accumulator cost = 1 + (halfArea(sideLower, sideUpper) * sideCount + rightAreas[b] * rightCounts[b]) / nodeArea;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+				}
+			}
+		}
+		if (bestAxis < 0 || (bestCost >= node.count && node.count <= MAX_LEAF_SIZE))
+			return index;
+
+		accumulator extent = centroidUpper[bestAxis] - centroidLower[bestAxis];
+		int middle = int(std::partition(order.begin() + first, order.begin() + last, [&](int t) {
+			return glm::min(int(BINS * (centroids[t][bestAxis] - centroidLower[bestAxis]) / extent), BINS - 1) < bestSplit;
+		}) - order.begin());
+		int left = build(buildNodes, source, order, centroids, first, middle);
+		int right = build(buildNodes, source, order, centroids, middle, last);
+		buildNodes[index].left = left;
+		buildNodes[index].right = right;
+		return index;
+	}
+
+	//Writes the build node and the levels below it as 4 wide nodes, children after their parent
+	int flatten(const std::vector<BuildNode> & buildNodes, int buildNode) {
+		//the inner child with the largest box is replaced by its children until there are 4
+		std::vector<int> children;
+		if (buildNodes[buildNode].left < 0)
+			children.push_back(buildNode);
+		else
+			children = { buildNodes[buildNode].left, buildNodes[buildNode].right };
+		while (children.size() < 4) {
+			int widest = -1;
+			accumulator widestArea = -1;
+			for (int k = 0; k < (int)children.size(); k++) {
+				const BuildNode & child = buildNodes[children[k]];
+				if (child.left >= 0 && halfArea(child.lower, child.upper) > widestArea) {
+					widest = k;
+					widestArea = halfArea(child.lower, child.upper);
+				}
+			}
+			if (widest < 0)
+				break;
+			int opened = children[widest];
+			children[widest] = buildNodes[opened].left;
+			children.push_back(buildNodes[opened].right);
+		}
+
+		int index = (int)nodes.size();
+		nodes.push_back(Node());
+		for (int lane = 0; lane < 4; lane++) {
+			Node & node = nodes[index];
+			if (lane >= (int)children.size()) {
+				node.lowerX[lane] = node.lowerY[lane] = node.lowerZ[lane] = std::numeric_limits<scalar>::max();
+				node.upperX[lane] = node.upperY[lane] = node.upperZ[lane] = std::numeric_limits<scalar>::lowest();
+				node.first[lane] = 0;
+				node.count[lane] = -1;
+				continue;
+			}
+			const BuildNode & child = buildNodes[children[lane]];
+			node.lowerX[lane] = scalar(child.lower.x);
+			node.lowerY[lane] = scalar(child.lower.y);
+			node.lowerZ[lane] = scalar(child.lower.z);
+			node.upperX[lane] = scalar(child.upper.x);
+			node.upperY[lane] = scalar(child.upper.y);
+			node.upperZ[lane] = scalar(child.upper.z);
+			node.first[lane] = child.first;
+			node.count[lane] = child.left < 0 ? child.count : 0;
+		}
+		for (int lane = 0; lane < (int)children.size(); lane++) {
+			if (buildNodes[children[lane]].left >= 0) {
+				int child = flatten(buildNodes, children[lane]);
+				nodes[index].first[lane] = child;
+			}
+		}
+		return index;
+	}
+
+	void buildHierarchy(const std::vector<Triangle> & source) {
+		nodes.clear();
+		triangles.clear();
+		lower = accumulatorVec3(std::numeric_limits<accumulator>::max());
+		upper = -lower;
+		if (source.empty())
+			return;
+
+		std::vector<int> order(source.size());
+		std::vector<accumulatorVec3> centroids(source.size());
+		for (int t = 0; t < (int)source.size(); t++) {
+			order[t] = t;
+			centroids[t] = (source[t].corners[0] + source[t].corners[1] + source[t].corners[2]) / accumulator(3);
+		}
+		std::vector<BuildNode> buildNodes;
+		build(buildNodes, source, order, centroids, 0, (int)source.size());
+		lower = buildNodes[0].lower;
+		upper = buildNodes[0].upper;
+		flatten(buildNodes, 0);
+
+		//the triangles of a leaf lie next to each other
+		triangles.resize(source.size());
+		for (int k = 0; k < (int)order.size(); k++)
+			triangles[k] = source[order[k]];
+	}
+
+	bool isInBounds(const accumulatorVec3 & position) {
+		return glm::all(glm::greaterThanEqual(position, lower)) && glm::all(glm::lessThanEqual(position, upper));
+	}
+
+	void addQuery(const vec3 & position, int particle) {
+		queries.push_back(makeQuery(position));
+		queryParticles.push_back(particle);
+	}
+
+	inline void testLeaf(Query & query, int first, int count) {
+		for (int t = first; t < first + count; t++) {
+			int feature;
+			accumulatorVec3 point = closestPoint(query.position, triangles[t], feature);
+			accumulatorVec3 vec = query.position - point;
+			accumulator squaredDistance = glm::dot(vec, vec);
+			if (squaredDistance < query.squaredDistance) {
+				query.squaredDistance = squaredDistance;
+				query.closestPoint = point;
+				query.normal = triangles[t].normals[feature];
+			}
+		}
+	}
+
+	inline void boxSquaredDistances(const Node & node, const accumulatorVec3 & position, scalar squaredDistances[4]) {
+		scalar x = scalar(position.x), y = scalar(position.y), z = scalar(position.z);
+		for (int lane = 0; lane < 4; lane++) {
+			scalar dx = glm::max(glm::max(node.lowerX[lane] - x, x - node.upperX[lane]), scalar(0));
+			scalar dy = glm::max(glm::max(node.lowerY[lane] - y, y - node.upperY[lane]), scalar(0));
+			scalar dz = glm::max(glm::max(node.lowerZ[lane] - z, z - node.upperZ[lane]), scalar(0));
+			squaredDistances[lane] = dx * dx + dy * dy + dz * dz;
+		}
+	}
+
+	//Descends to the nearest leaf of the query and tests it, so the query starts the traversal with a close bound
+	void seed(Query & query) {
+		int node = 0;
+		while (true) {
+			scalar squaredDistances[4];
+			boxSquaredDistances(nodes[node], query.position, squaredDistances);
+			int nearest = -1;
+			for (int lane = 0; lane < 4; lane++) {
+				if (nodes[node].count[lane] >= 0 && (nearest < 0 || squaredDistances[lane] < squaredDistances[nearest]))
+					nearest = lane;
+			}
+			if (nodes[node].count[nearest] > 0) {
+				testLeaf(query, nodes[node].first[nearest], nodes[node].count[nearest]);
+				return;
+			}
+			node = nodes[node].first[nearest];
+		}
+	}
+
+	//Finds the closest point on the mesh of every query, all queries traverse the hierarchy together
+	void findClosest() {
+		if (nodes.empty() || queries.empty())
+			return;
+		for (Query & query : queries)
+			seed(query);
+		active.resize(queries.size());
+		for (int q = 0; q < (int)queries.size(); q++)
+			active[q] = q;
+		packets.clear();
+		Packet root = { 0, 0, (int)queries.size() };
+		packets.push_back(root);
+
+		while (!packets.empty()) {
+			//the packet on top of the stack always owns the end of active
+			Packet packet = packets.back();
+			packets.pop_back();
+			const Node & node = nodes[packet.node];
+
+			accumulator laneNearest[4];
+			for (int lane = 0; lane < 4; lane++) {
+				laneQueries[lane].clear();
+				laneNearest[lane] = std::numeric_limits<accumulator>::max();
+			}
+			for (int k = packet.first; k < packet.first + packet.count; k++) {
+				const Query & query = queries[active[k]];
+				scalar squaredDistances[4];
+				boxSquaredDistances(node, query.position, squaredDistances);
+				for (int lane = 0; lane < 4; lane++) {
+					if (node.count[lane] >= 0 && squaredDistances[lane] < query.squaredDistance) {
+						laneQueries[lane].push_back(active[k]);
+						laneNearest[lane] = glm::min(laneNearest[lane], accumulator(squaredDistances[lane]));
+					}
+				}
+			}
+			active.resize(packet.first);
+
+			//leaves right away nearest first so the bounds shrink early, inner children farthest first onto the stack so
+			//the nearest one is visited next
+			int lanes[4] = { 0, 1, 2, 3 };
+			std::sort(lanes, lanes + 4, [&](int a, int b) {
+				return laneNearest[a] < laneNearest[b];
+			});
+			for (int lane : lanes) {
+				if (node.count[lane] > 0) {
+					for (int q : laneQueries[lane])
+						testLeaf(queries[q], node.first[lane], node.count[lane]);
+				}
+			}
+			for (int k = 3; k >= 0; k--) {
+				int lane = lanes[k];
+				if (node.count[lane] == 0 && !laneQueries[lane].empty()) {
+					Packet child = { node.first[lane], (int)active.size(), (int)laneQueries[lane].size() };
+					active.insert(active.end(), laneQueries[lane].begin(), laneQueries[lane].end());
+					packets.push_back(child);
+				}
+			}
+		}
+	}
+
+	//Finds the closest point on the mesh of a single query. Its traversal stack is local, so unlike the packet
+	//traversal of findClosest it shares no buffers and single queries may run concurrently.
+	void findClosest(Query & query) {
+		if (nodes.empty())
+			return;
+		seed(query);
+		std::vector<int> stack;
+		stack.reserve(64);
+		stack.push_back(0);
+		while (!stack.empty()) {
+			const Node & node = nodes[stack.back()];
+			stack.pop_back();
+			scalar squaredDistances[4];
+			boxSquaredDistances(node, query.position, squaredDistances);
+			int lanes[4] = { 0, 1, 2, 3 };
+			std::sort(lanes, lanes + 4, [&](int a, int b) {
+				return squaredDistances[a] < squaredDistances[b];
+			});
+			for (int lane : lanes) {
+				if (node.count[lane] > 0 && squaredDistances[lane] < query.squaredDistance)
+					testLeaf(query, node.first[lane], node.count[lane]);
+			}
+			for (int k = 3; k >= 0; k--) {
+				int lane = lanes[k];
+				if (node.count[lane] == 0 && squaredDistances[lane] < query.squaredDistance)
+					stack.push_back(node.first[lane]);
+			}
+		}
+	}
+
+	Query makeQuery(const vec3 & position) {
+		Query query;
+		query.position = accumulatorVec3(position) + offset;
+		query.squaredDistance = std::numeric_limits<accumulator>::max();
+		return query;
+	}
+
+	bool isInside(const Query & query) {
+		return query.squaredDistance < std::numeric_limits<accumulator>::max()
+			&& glm::dot(query.position - query.closestPoint, query.normal) < 0;
+	}
+
+	accumulator signedDistance(const Query & query) {
+		accumulator distance = glm::sqrt(query.squaredDistance);
+		return isInside(query) ? -distance : distance;
+	}
+
+	//lower bound of the distance of a position outside of the bounds of the mesh
+	accumulator boundsDistance(const accumulatorVec3 & position) {
+		return glm::length(glm::max(glm::max(lower - position, position - upper), accumulatorVec3(0)));
+	}
+
+public:
+	//the triangles index into the vertices and face outwards when their corners are counterclockwise
+	TriangleMeshColliderT(const std::vector<vec3> & vertices, const std::vector<glm::ivec3> & indices, GLhandleARB shaderProgramId) : ColliderT<P>() {
+		std::vector<Triangle> source;
+		setTriangles(vertices, indices, source);
+		buildHierarchy(source);
+
+		std::vector<::vec3> corners;
+		for (const Triangle & triangle : triangles) {
+			for (const accumulatorVec3 & corner : triangle.corners)
+				corners.push_back(::vec3(corner));
+		}
+		this->renderer = new MeshRenderer(shaderProgramId, corners);
+		this->renderer->setupOpenGLBuffers();
+	}
+
+	//Reads the vertices and faces of a Wavefront OBJ file, faces with more corners are split into fans. Returns
+	//nullptr if the file cannot be read.
+	static TriangleMeshColliderT * loadOBJ(const std::string & filename, GLhandleARB shaderProgramId) {
+		std::ifstream file(filename);
+		if (!file) {
+			std::cout << "Sorry, can't open mesh: " << filename << std::endl;
+			return nullptr;
+		}
+		std::vector<vec3> vertices;
+		std::vector<glm::ivec3> indices;
+		std::string line;
+		while (std::getline(file, line)) {
+			std::istringstream stream(line);
+			std::string type;
+			stream >> type;
+			if (type == "v") {
+				vec3 vertex;
+				stream >> vertex.x >> vertex.y >> vertex.z;
+				vertices.push_back(vertex);
+			}
+			else if (type == "f") {
+				std::vector<int> face;
+				std::string corner;
+				while (stream >> corner) {
+					//v, v/vt, v//vn or v/vt/vn, negative indices count from the last vertex
+					int index = std::atoi(corner.c_str());
+					face.push_back(index < 0 ? (int)vertices.size() + index : index - 1);
+				}
+				for (int k = 2; k < (int)face.size(); k++)
+					indices.push_back(glm::ivec3(face[0], face[k - 1], face[k]));
+			}
+		}
+		for (const glm::ivec3 & index : indices) {
+			if (glm::any(glm::lessThan(index, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(index, glm::ivec3((int)vertices.size())))) {
+				std::cout << "Mesh " << filename << " has faces with invalid vertices" << std::endl;
+				return nullptr;
+			}
+		}
+		return new TriangleMeshColliderT(vertices, indices, shaderProgramId);
+	}
+
+	void handleCollision(vec3 & particlePosition) {
+		Query query = makeQuery(particlePosition);
+		if (!isInBounds(query.position))
+			return;
+		findClosest(query);
+		if (isInside(query))
+			particlePosition = vec3(query.closestPoint - offset);
+	}
+
+	void handleCollisions(std::vector<vec3> & positions, const std::vector<int> & particles) {
+		queries.clear();
+		queryParticles.clear();
+		//the mesh is closed, particles outside of its bounds cannot be inside
+		for (int i : particles) {
+			if (isInBounds(accumulatorVec3(positions[i]) + offset))
+				addQuery(positions[i], i);
+		}
+		findClosest();
+		for (int q = 0; q < (int)queries.size(); q++) {
+			if (isInside(queries[q]))
+				positions[queryParticles[q]] = vec3(queries[q].closestPoint - offset);
+		}
+	}
+
+	//outside of the bounds of the mesh the distance to the bounds. Safe to call from several threads, as when a
+	//distance grid is baked from the mesh.
+	scalar getDistance(const vec3 & particlePosition) {
+		Query query = makeQuery(particlePosition);
+		if (!isInBounds(query.position))
+			return scalar(boundsDistance(query.position));
+		findClosest(query);
+		return scalar(signedDistance(query));
+	}
+
+	void getDistances(const std::vector<vec3> & positions, const std::vector<int> & particles, std::vector<scalar> & distances) {
+		distances.resize(particles.size());
+		queries.clear();
+		queryParticles.clear();
+		for (int k = 0; k < (int)particles.size(); k++) {
+			accumulatorVec3 position = accumulatorVec3(positions[particles[k]]) + offset;
+			if (isInBounds(position))
+				addQuery(positions[particles[k]], k);
+			else
+				distances[k] = scalar(boundsDistance(position));
+		}
+		findClosest();
+		for (int q = 0; q < (int)queries.size(); q++)
+			distances[queryParticles[q]] = scalar(signedDistance(queries[q]));
+	}
+
+	//The shortest edge, the mesh does not know how thin it is otherwise but a feature thinner than its shortest
+	//edge would need skinnier triangles
+	scalar getThickness() {
+		return thickness;
+	}
+
+	int getNumberOfTriangles() {
+		return (int)triangles.size();
+	}
+
+	void shiftOrigin(const vec3 & shift) {
+		offset += accumulatorVec3(shift);
+		ColliderT<P>::shiftOrigin(shift);
+	}
+};
+
+typedef TriangleMeshColliderT<WorldPrecision> TriangleMeshCollider;
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <glm/glm.hpp>
+
+#include "Constraint.h"
+#include "ParticleStore.h"
+
+// Particle pair of a distance constraint in a compile time topology.
+struct ConstraintPair {
+	int p1, p2;
+};
+
+// Constraint pass for bodies whose topology is known at compile time. A Topology provides
+//   static const int numberOfParticles, numberOfConstraints, firstConstraint;
+//   static constexpr ConstraintPair constraint(int j);
+// The pass loads the particles of the body into local variables once, projects every constraint with its particle
+// indices as template arguments (so the pass is fully unrolled and needs no index loads) and writes the particles
+// back once. The rest lengths are read from the constraint vector of the object, which has to list the constraints
+// in topology order starting at firstConstraint. The projection is the same as ConstraintT::solveConstraint.
+template <typename P, typename Topology>
+class UnrolledConstraintSolverT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	static const int numberOfParticles = Topology::numberOfParticles;
+
+	template <int p1, int p2>
+	static inline void project(accumulatorVec3 * x, const bool * movable, accumulator restDistance,
+		accumulator & maxResidual, accumulator & squaredResidualSum) {
+		accumulatorVec3 vec = x[p1] - x[p2];
+		accumulator length = glm::length(vec);
+		accumulator residual = restDistance;
+		if (length != accumulator(0)) {
+			accumulatorVec3 correction = accumulator(0.5) * (length - restDistance) / length * vec;
+			if (movable[p1])
+				x[p1] -= correction;
+			if (movable[p2])
+				x[p2] += correction;
+			residual = glm::abs(length - restDistance);
+		}
+		maxResidual = glm::max(maxResidual, residual);
+		squaredResidualSum += residual * residual;
+	}
+
+	template <typename Index, int... j>
+	static inline void projectAll(accumulatorVec3 * x, const bool * movable, std::vector<ConstraintT<P, Index> > & constraints,
+		accumulator & maxResidual, accumulator & squaredResidualSum, std::integer_sequence<int, j...>) {
+		//expands to one project call per constraint, in order
+		int expand[] = { 0, (project<Topology::constraint(j).p1, Topology::constraint(j).p2>(
+			x, movable, accumulator(constraints[Topology::firstConstraint + j].getRestDistance()), maxResidual, squaredResidualSum), 0)... };
+		(void)expand;
+	}
+
+public:
+	//One pass over all constraints of the body starting at firstParticle:
+	template <typename Index>
+	static void solve(ParticleStoreT<P> & particles, int firstParticle, std::vector<ConstraintT<P, Index> > & constraints,
+		accumulator & maxResidual, accumulator & squaredResidualSum) {
+		accumulatorVec3 x[numberOfParticles];
+		bool movable[numberOfParticles];
+		for (int i = 0; i < numberOfParticles; i++) {
+			x[i] = accumulatorVec3(particles.positions[firstParticle + i]);
+			movable[i] = particles.isMovables[firstParticle + i];
+		}
+
+		projectAll(x, movable, constraints, maxResidual, squaredResidualSum,
+			std::make_integer_sequence<int, Topology::numberOfConstraints>());
+
+		for (int i = 0; i < numberOfParticles; i++)
+			particles.positions[firstParticle + i] = vec3(x[i]);
+	}
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Precision.h"
+
+// Bookkeeping of a Verlet list: candidate pairs are collected with a margin, the skin, on top of their contact
+// distance and reused as long as no particle moved more than half the skin since, because until then no pair that
+// was left out can have come into contact. Counts the steps and the rebuilds, so the reuse can be reported.
+template <typename P>
+class VerletListT {
+private:
+	typedef typename P::scalar scalar;
+	typedef typename P::vec3 vec3;
+	typedef typename P::accumulator accumulator;
+	typedef typename P::accumulatorVec3 accumulatorVec3;
+
+	scalar skin;
+	std::vector<int> particles; // global indices the list was built for
+	std::vector<accumulatorVec3> referencePositions;
+	bool valid = false;
+	int steps = 0, rebuilds = 0;
+
+public:
+	VerletListT(scalar skin) {
+		this->skin = skin;
+	}
+
+	//Called once per step with the particles the list covers. Returns true if the list has to be rebuilt, the
+	//current positions are then the new reference.
+	bool needsRebuild(const std::vector<vec3> & positions, const std::vector<int> & particles) {
+		steps++;
+		bool rebuild = !valid || skin <= 0 || particles != this->particles;
+		accumulator maxSquaredDisplacement = accumulator(0.25) * skin * skin;
+		for (int k = 0; !rebuild && k < (int)particles.size(); k++) {
+			accumulatorVec3 displacement = accumulatorVec3(positions[particles[k]]) - referencePositions[k];
+			rebuild = glm::dot(displacement, displacement) > maxSquaredDisplacement;
+		}
+		if (!rebuild)
+			return false;
+
+		this->particles = particles;
+		referencePositions.resize(particles.size());
+		for (int k = 0; k < (int)particles.size(); k++)
+			referencePositions[k] = accumulatorVec3(positions[particles[k]]);
+		valid = true;
+		rebuilds++;
+		return true;
+	}
+
+	//for when what the list depends on changed other than the positions
+	void invalidate() {
+		valid = false;
+	}
+
+	scalar getSkin() {
+		return skin;
+	}
+
+	void setSkin(scalar skin) {
+		this->skin = skin;
+		valid = false;
+	}
+
+	//share of the steps since the last reset that rebuilt the list
+	double getRebuildFrequency() {
+		return steps > 0 ? double(rebuilds) / steps : 0.0;
+	}
+
+	void resetStatistics() {
+		steps = 0;
+		rebuilds = 0;
+	}
+};
+
+typedef VerletListT<WorldPrecision> VerletList;
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <limits>
+
+#include "ParticleStore.h"
+#include "PositionBasedObject.h"
+#include "ParticleCollision.h"
+#include "SegmentCollision.h"
+#include "PerfCounters.h"
+
+// Steps all objects together: every object is integrated first, then the constraints of all objects and the
+// connectors between them are relaxed in one shared iteration loop, then collisions are resolved. Both ends of a
+// connector therefore see each other's corrections within the same step.
+// The constraint loop is residual driven: an object stops iterating once its largest violation is below the
+// tolerance, constraintIterations is only the upper bound. A violated connector wakes the objects on both ends.
+// Particles and rope segments of different objects collide with each other before the static colliders are handled.
+class World {
+private:
+	ParticleStore particles;
+	std::vector<PositionBasedObject*> objects;
+	std::vector<bool> converged; // per object, within the current step
+	ParticleCollision particleCollision;
+	bool particleCollisionsEnabled = true;
+	SegmentCollision segmentCollision;
+	bool segmentCollisionsEnabled = true;
+
+	PhaseProfiler * profiler = NULL;
+	int constraintIterations;
+	SCALAR constraintTolerance = 0;
+	SCALAR dragConstant = 0; // applied to every object on top of its own drag
+	SCALAR verletSkin = 0; // of the candidate lists of the collisions, 0 searches every step
+
+	//index of the object owning the global particle index, -1 if none
+	int findObject(int particle) {
+		for (int i = 0; i < (int)objects.size(); i++) {
+			int first = objects[i]->getFirstParticle();
+			if (particle >= first && particle < first + objects[i]->getNumberOfParticles())
+				return i;
+		}
+		return -1;
+	}
+
+public:
+	World(int constraintIterations) {
+		this->constraintIterations = constraintIterations;
+	}
+
+	ParticleStore & getParticles() {
+		return particles;
+	}
+
+	void addObject(PositionBasedObject * object) {
+		objects.push_back(object);
+		converged.push_back(false);
+		object->solver->setConstraintTolerance(constraintTolerance);
+		object->solver->setColliderSkin(verletSkin);
+	}
+
+	//Advance all simulated objects one time step:
+	void step(SCALAR timeStepSize, bool dragEnabled) {
+		if (profiler)
+			profiler->begin(integrationPhase);
+
+		for (PositionBasedObject * object : objects) {
+			if (object->isSimulated())
+				object->solver->integrate(timeStepSize, dragEnabled, dragConstant);
+		}
+
+		if (profiler) {
+			profiler->end(integrationPhase);
+			profiler->begin(constraintPhase);
+		}
+
+		for (int k = 0; k < (int)objects.size(); k++)
+			converged[k] = !objects[k]->isSimulated();
+
+		for (int i = 0; i < constraintIterations; i++) {
+			bool allConverged = true;
+			for (int k = 0; k < (int)objects.size(); k++) {
+				if (converged[k])
+					continue;
+				objects[k]->solver->solveConstraints();
+				converged[k] = objects[k]->solver->isConverged();
+				allConverged = allConverged && converged[k];
+			}
+			for (int k = 0; k < (int)objects.size(); k++) {
+				if (!objects[k]->isSimulated())
+					continue;
+				if (objects[k]->solver->solveConnectors() >= constraintTolerance) {
+					wakeConnectedObjects(k);
+					allConverged = false;
+				}
+			}
+			if (allConverged)
+				break;
+		}
+
+		if (profiler) {
+			profiler->end(constraintPhase);
+			profiler->begin(collisionPhase);
+		}
+
+		if (particleCollisionsEnabled) {
+			particleCollision.clear();
+			for (PositionBasedObject * object : objects) {
+				if (object->isSimulated())
+					particleCollision.addParticles(particles, object->getFirstParticle(), object->getNumberOfParticles());
+			}
+			particleCollision.solve(particles);
+		}
+
+		if (segmentCollisionsEnabled) {
+			segmentCollision.clear();
+			for (PositionBasedObject * object : objects) {
+				if (object->isSimulated() && object->hasCollidingSegments())
+					segmentCollision.addSegments(particles, object->getFirstParticle(), object->getConstraints());
+			}
+			segmentCollision.solve(particles);
+		}
+
+		for (PositionBasedObject * object : objects) {
+			if (object->isSimulated())
+				object->solver->handleCollisions();
+		}
+
+		if (profiler)
+			profiler->end(collisionPhase);
+
+		for (PositionBasedObject * object : objects) {
+			if (object->isSimulated())
+				object->solver->updateVelocities(timeStepSize);
+		}
+	}
+
+	//The connectors of object k moved particles on both ends, so neither side can be considered converged
+	void wakeConnectedObjects(int k) {
+		converged[k] = false;
+		for (ConnectorConstraint & connector : objects[k]->solver->getConnectors()) {
+			int other = findObject(connector.getP2());
+			if (other >= 0 && objects[other]->isSimulated())
+				converged[other] = false;
+		}
+	}
+
+	void setParticleCollisions(bool enabled) {
+		particleCollisionsEnabled = enabled;
+	}
+
+	//overlapping particle pairs of different objects in the last step
+	int getNumberOfParticleContacts() {
+		return particleCollisionsEnabled ? particleCollision.getNumberOfContacts() : 0;
+	}
+
+	//The candidate pairs of particles and of particles and colliders are reused until a particle moved half the skin
+	void setVerletSkin(SCALAR verletSkin) {
+		this->verletSkin = verletSkin;
+		particleCollision.setSkin(verletSkin);
+		for (PositionBasedObject * object : objects)
+			object->solver->setColliderSkin(verletSkin);
+	}
+
+	void setSegmentCollisions(bool enabled) {
+		segmentCollisionsEnabled = enabled;
+	}
+
+	int getNumberOfSegmentContacts() {
+		return segmentCollisionsEnabled ? segmentCollision.getNumberOfContacts() : 0;
+	}
+
+	void setConstraintIterations(int constraintIterations) {
+		this->constraintIterations = constraintIterations;
+	}
+
+	void setDragConstant(SCALAR dragConstant) {
+		this->dragConstant = dragConstant;
+	}
+
+	void setConstraintTolerance(SCALAR constraintTolerance) {
+		this->constraintTolerance = constraintTolerance;
+		for (PositionBasedObject * object : objects)
+			object->solver->setConstraintTolerance(constraintTolerance);
+	}
+
+	SCALAR getMaxSpeed() {
+		SCALAR maxSpeed = 0;
+		for (PositionBasedObject * object : objects) {
+			if (object->isSimulated())
+				maxSpeed = glm::max(maxSpeed, object->solver->getMaxSpeed());
+		}
+		return maxSpeed;
+	}
+
+	SCALAR getSmallestFeatureSize() {
+		SCALAR featureSize = std::numeric_limits<SCALAR>::max();
+		for (PositionBasedObject * object : objects) {
+			if (object->isSimulated())
+				featureSize = glm::min(featureSize, object->solver->getSmallestFeatureSize());
+		}
+		return featureSize;
+	}
+
+	//Prints the constraint passes and residuals of the last step per simulated object:
+	void printResiduals() {
+		for (int k = 0; k < (int)objects.size(); k++) {
+			if (!objects[k]->isSimulated())
+				continue;
+			Solver * solver = objects[k]->solver;
+			std::cout << "object " << k << ": " << solver->getIterations() << " iterations, max residual "
+				<< solver->getMaxResidual() << ", rms " << solver->getRmsResidual();
+			if (solver->isAccelerated()) {
+				ChebyshevAccelerator & chebyshev = solver->getChebyshevAccelerator();
+				std::cout << ", chebyshev rho " << chebyshev.getSpectralRadius() << ", " << chebyshev.getIterationsSaved() << " iterations saved";
+				chebyshev.resetIterationsSaved();
+			}
+			if (solver->getIntegrationScheme() == implicitEuler)
+				std::cout << ", " << solver->getImplicitIterations() << " conjugate gradient iterations";
+			std::cout << std::endl;
+		}
+		if (particleCollisionsEnabled) {
+			VerletList & verletList = particleCollision.getVerletList();
+			std::cout << "particle contacts: " << particleCollision.getNumberOfContacts() << ", neighbour list rebuilt in "
+				<< 100 * verletList.getRebuildFrequency() << "% of the steps" << std::endl;
+			verletList.resetStatistics();
+		}
+		double colliderRebuilds = 0;
+		int simulatedObjects = 0;
+		for (PositionBasedObject * object : objects) {
+			if (object->isSimulated()) {
+				colliderRebuilds += object->solver->getColliderList().getRebuildFrequency();
+				simulatedObjects++;
+			}
+			object->solver->getColliderList().resetStatistics();
+		}
+		if (simulatedObjects > 0)
+			std::cout << "collider candidate lists rebuilt in " << 100 * colliderRebuilds / simulatedObjects << "% of the steps" << std::endl;
+		if (segmentCollisionsEnabled)
+			std::cout << "segment contacts: " << segmentCollision.getNumberOfContacts() << std::endl;
+	}
+
+	void setProfiler(PhaseProfiler * profiler) {
+		this->profiler = profiler;
+	}
+};